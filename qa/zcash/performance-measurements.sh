@@ -216,6 +216,13 @@ case "$1" in
             listunspent)
                 zcash_rpc zcbenchmark listunspent 10
                 ;;
+            availablecoins)
+                zcash_rpc zcbenchmark availablecoins 10 "${@:3}"
+                ;;
+            notarizeddata)
+                zcash_rpc zcbenchmark notarizeddata 10 "${@:3}"
+                zcash_rpc zcbenchmark notarizeddatascan 10 "${@:3}"
+                ;;
             *)
                 zcashd_stop
                 echo "Bad arguments to time."
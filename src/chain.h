@@ -17,6 +17,7 @@
 #include <boost/foreach.hpp>
 
 static const int SPROUT_VALUE_VERSION = 1001400;
+static const int NOTARYPUBKEY_VERSION = 1001553;
 
 struct CDiskBlockPos
 {
@@ -96,6 +97,7 @@ enum BlockStatus: uint32_t {
     BLOCK_FAILED_MASK        =   BLOCK_FAILED_VALID | BLOCK_FAILED_CHILD,
 
     BLOCK_ACTIVATES_UPGRADE  =   128, //! block activates a network upgrade
+    BLOCK_UNDO_LOCKTIME      =   256, //! undo data carries nLockTime of fully spent transactions
 };
 
 //! Short-hand for the highest consensus validity we implement.
@@ -206,6 +208,9 @@ public:
         nBits          = 0;
         nNonce         = uint256();
         nSolution.clear();
+
+        notaryid       = -1;
+        memset(pubkey33, 0, sizeof(pubkey33));
     }
 
     CBlockIndex()
@@ -383,6 +388,13 @@ public:
         if ((nType & SER_DISK) && (nVersion >= SPROUT_VALUE_VERSION)) {
             READWRITE(nSproutValue);
         }
+
+        // Only read/write the block producer's pubkey if the client version used to
+        // create this index was storing it, older entries are migrated on load.
+        if ((nType & SER_DISK) && (nVersion >= NOTARYPUBKEY_VERSION)) {
+            READWRITE(notaryid);
+            READWRITE(FLATDATA(pubkey33));
+        }
     }
 
     uint256 GetBlockHash() const
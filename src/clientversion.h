@@ -18,7 +18,7 @@
 #define CLIENT_VERSION_MAJOR 1
 #define CLIENT_VERSION_MINOR 0
 #define CLIENT_VERSION_REVISION 15
-#define CLIENT_VERSION_BUILD 52
+#define CLIENT_VERSION_BUILD 54
 
 //! Set to true for release, false for prerelease or test build
 #define CLIENT_VERSION_IS_RELEASE true
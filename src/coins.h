@@ -21,6 +21,8 @@
 #include <boost/unordered_map.hpp>
 #include "zcash/IncrementalMerkleTree.hpp"
 
+static const int COINS_LOCKTIME_VERSION = 1001554;
+
 /** 
  * Pruned version of CTransaction: only retains metadata and unspent transaction outputs
  *
@@ -30,6 +32,7 @@
  * - unspentness bitvector, for vout[2] and further; least significant byte first
  * - the non-spent CTxOuts (via CTxOutCompressor)
  * - VARINT(nHeight)
+ * - nLockTime, on disk from COINS_LOCKTIME_VERSION onwards
  *
  * The nCode value consists of:
  * - bit 1: IsCoinBase()
@@ -88,14 +91,16 @@ public:
     //! version of the CTransaction; accesses to this value should probably check for nHeight as well,
     //! as new tx version will probably only be introduced at certain heights
     int nVersion;
-    //uint32_t nLockTime;
+
+    //! nLockTime of the CTransaction, needed for KMD interest without fetching the transaction
+    uint32_t nLockTime;
 
     void FromTx(const CTransaction &tx, int nHeightIn) {
         fCoinBase = tx.IsCoinBase();
         vout = tx.vout;
         nHeight = nHeightIn;
         nVersion = tx.nVersion;
-        //nLockTime = tx.nLockTime;
+        nLockTime = tx.nLockTime;
         ClearUnspendable();
     }
 
@@ -109,10 +114,11 @@ public:
         std::vector<CTxOut>().swap(vout);
         nHeight = 0;
         nVersion = 0;
+        nLockTime = 0;
     }
 
     //! empty constructor
-    CCoins() : fCoinBase(false), vout(0), nHeight(0), nVersion(0) { }
+    CCoins() : fCoinBase(false), vout(0), nHeight(0), nVersion(0), nLockTime(0) { }
 
     //!remove spent outputs at the end of vout
     void Cleanup() {
@@ -135,6 +141,7 @@ public:
         to.vout.swap(vout);
         std::swap(to.nHeight, nHeight);
         std::swap(to.nVersion, nVersion);
+        std::swap(to.nLockTime, nLockTime);
     }
 
     //! equality test
@@ -145,6 +152,7 @@ public:
          return a.fCoinBase == b.fCoinBase &&
                 a.nHeight == b.nHeight &&
                 a.nVersion == b.nVersion &&
+                a.nLockTime == b.nLockTime &&
                 a.vout == b.vout;
     }
     friend bool operator!=(const CCoins &a, const CCoins &b) {
@@ -177,6 +185,9 @@ public:
                 nSize += ::GetSerializeSize(CTxOutCompressor(REF(vout[i])), nType, nVersion);
         // height
         nSize += ::GetSerializeSize(VARINT(nHeight), nType, nVersion);
+        // locktime
+        if ((nType & SER_DISK) && (nVersion >= COINS_LOCKTIME_VERSION))
+            nSize += ::GetSerializeSize(nLockTime, nType, nVersion);
         return nSize;
     }
 
@@ -207,6 +218,9 @@ public:
         }
         // coinbase height
         ::Serialize(s, VARINT(nHeight), nType, nVersion);
+        // locktime
+        if ((nType & SER_DISK) && (nVersion >= COINS_LOCKTIME_VERSION))
+            ::Serialize(s, nLockTime, nType, nVersion);
     }
 
     template<typename Stream>
@@ -240,6 +254,10 @@ public:
         }
         // coinbase height
         ::Unserialize(s, VARINT(nHeight), nType, nVersion);
+        // locktime
+        nLockTime = 0;
+        if ((nType & SER_DISK) && (nVersion >= COINS_LOCKTIME_VERSION))
+            ::Unserialize(s, nLockTime, nType, nVersion);
         Cleanup();
     }
 
@@ -37,6 +37,11 @@ uint64_t komodo_accrued_interest(int32_t *txheightp,uint32_t *locktimep,uint256
     return(0);
 }
 
+uint64_t komodo_coins_interest(int32_t txheight,uint32_t locktime,uint64_t value,int32_t tipheight)
+{
+    return(0);
+}
+
 static bool fCreateBlank;
 static map<string,UniValue> registers;
 
@@ -29,6 +29,11 @@
 
 #include <stdint.h>
 #include <stdio.h>
+#include <sys/stat.h>
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <fcntl.h>
+#endif
 #include <pthread.h>
 #include <ctype.h>
 #include "uthash.h"
@@ -36,7 +41,7 @@
 
 int32_t gettxout_scriptPubKey(uint8_t *scriptPubkey,int32_t maxsize,uint256 txid,int32_t n);
 void komodo_event_rewind(struct komodo_state *sp,char *symbol,int32_t height);
-void komodo_connectblock(CBlockIndex *pindex,CBlock& block);
+void komodo_connectblock(CBlockIndex *pindex,CBlock& block,CBlockUndo *blockundo);
 
 #include "komodo_structs.h"
 #include "komodo_globals.h"
@@ -217,6 +222,40 @@ int32_t memread(void *dest,int32_t size,uint8_t *filedata,long *fposp,long datal
     return(-1);
 }
 
+// size of the complete komodostate record at data, 0 while its writer is still appending it, -1 if unknown
+long komodo_staterecordlen(uint8_t *data,long datalen)
+{
+    long len = 1 + sizeof(int32_t); uint16_t olen;
+    if ( datalen < len )
+        return(0);
+    switch ( data[0] )
+    {
+        case 'P':
+            if ( datalen < len+1 )
+                return(0);
+            len += 1 + (data[len] <= 64 ? 33 * data[len] : 0);
+            break;
+        case 'N': len += sizeof(int32_t) + 2*sizeof(uint256); break;
+        case 'M': len += sizeof(int32_t) + 3*sizeof(uint256) + sizeof(int32_t); break;
+        case 'U': len += 2 + sizeof(uint64_t) + sizeof(uint256); break;
+        case 'K': len += sizeof(int32_t); break;
+        case 'T': len += 2*sizeof(int32_t); break;
+        case 'R':
+            if ( datalen < len + sizeof(uint256) + sizeof(uint16_t) + sizeof(uint64_t) + sizeof(olen) )
+                return(0);
+            memcpy(&olen,&data[len + sizeof(uint256) + sizeof(uint16_t) + sizeof(uint64_t)],sizeof(olen));
+            len += sizeof(uint256) + sizeof(uint16_t) + sizeof(uint64_t) + sizeof(olen) + olen;
+            break;
+        case 'V':
+            if ( datalen < len+1 )
+                return(0);
+            len += 1 + (data[len] <= 128 ? sizeof(uint32_t) * data[len] : 0);
+            break;
+        default: return(-1);
+    }
+    return(datalen >= len ? len : 0);
+}
+
 int32_t komodo_parsestatefiledata(struct komodo_state *sp,uint8_t *filedata,long *fposp,long datalen,char *symbol,char *dest)
 {
     static int32_t errs;
@@ -349,10 +388,126 @@ int32_t komodo_parsestatefiledata(struct komodo_state *sp,uint8_t *filedata,long
     return(-1);
 }
 
+void komodo_journal_write(struct komodo_journal *jp,void *data,long len)
+{
+    if ( jp->len + len > jp->size )
+    {
+        jp->size = (jp->len + len) * 2;
+        jp->buf = (uint8_t *)realloc(jp->buf,jp->size);
+    }
+    memcpy(&jp->buf[jp->len],data,len);
+    jp->len += len;
+}
+
+void komodo_journal_putc(struct komodo_journal *jp,uint8_t c)
+{
+    komodo_journal_write(jp,&c,sizeof(c));
+}
+
+// one fwrite and fflush for everything appended since the last commit, fsync according to KOMODO_STATESYNC or when syncflag is set
+int32_t komodo_journal_commit(struct komodo_journal *jp,int32_t syncflag)
+{
+    int32_t retval = 0;
+    if ( jp->fp == 0 )
+        return(-1);
+    if ( jp->len > 0 )
+    {
+        if ( fwrite(jp->buf,1,jp->len,jp->fp) != jp->len )
+        {
+            fprintf(stderr,"[%s] error appending %ld journal bytes\n",ASSETCHAINS_SYMBOL,jp->len);
+            retval = -1;
+        }
+        jp->len = 0;
+        fflush(jp->fp);
+        if ( jp->lastsync == 0 )
+            jp->lastsync = OS_milliseconds();
+    }
+    if ( jp->lastsync != 0 && (syncflag != 0 || KOMODO_STATESYNC == 1 || (KOMODO_STATESYNC > 1 && OS_milliseconds() > jp->lastsync + KOMODO_STATESYNC)) )
+    {
+        FileCommit(jp->fp);
+        jp->lastsync = 0;
+    }
+    return(retval);
+}
+
+// a crash can leave the last record half written, cut it off so new records are appended on a record boundary.
+// only what was appended after snappos is scanned, without a snapshot the full replay reads the whole file anyway.
+// the position of fp is left where it was
+long komodo_staterecover(FILE *fp,char *fname,long snappos)
+{
+    struct komodo_tail *tp; uint8_t *data; long datalen,fpos,prevpos,n,validpos,savepos;
+    savepos = ftell(fp);
+    if ( (validpos= snappos) < 0 )
+        validpos = 0;
+    tp = komodo_tail_open(fname,validpos);
+    while ( 1 )
+    {
+        prevpos = tp->pos;
+        datalen = komodo_tail_read(tp,&data);
+        for (fpos=0; (n= komodo_staterecordlen(&data[fpos],datalen - fpos)) > 0; fpos += n)
+            ;
+        komodo_tail_consume(tp,fpos);
+        validpos += fpos;
+        if ( n < 0 || tp->pos == prevpos )
+            break;
+    }
+    if ( n == 0 && tp->len > 0 && validpos < 0xffffffffL ) // an unknown record type is left alone, the parser stops there anyway
+    {
+        fprintf(stderr,"[%s] dropping partial %ld byte record at the end of %s\n",ASSETCHAINS_SYMBOL,tp->len,fname);
+        fflush(fp);
+        if ( TruncateFile(fp,(unsigned int)validpos) == 0 )
+            validpos = tp->pos;
+    } else validpos = tp->pos;
+    komodo_tail_close(tp);
+    fseek(fp,savepos,SEEK_SET);
+    return(validpos);
+}
+
+// called once komodo_connectblock is done with a block, and after every stateupdate outside of it
+void komodo_stateflush(struct komodo_state *sp)
+{
+    static long snappos = -1; long fpos;
+    if ( KOMODO_STATEJOURNAL.fp == 0 )
+        return;
+    if ( snappos < 0 )
+        snappos = ftell(KOMODO_STATEJOURNAL.fp);
+    komodo_journal_commit(&KOMODO_STATEJOURNAL,0);
+    if ( KOMODO_SIGNEDJOURNAL.fp != 0 )
+        komodo_journal_commit(&KOMODO_SIGNEDJOURNAL,0);
+    if ( sp != 0 && (fpos= ftell(KOMODO_STATEJOURNAL.fp)) > snappos + KOMODO_SNAPSHOT_INTERVAL && komodo_snapshot_save(sp,KOMODO_STATEJOURNAL.fp,fpos) == 0 )
+        snappos = fpos;
+}
+
+void komodo_stateclose()
+{
+    if ( KOMODO_STATEJOURNAL.fp != 0 )
+        komodo_journal_commit(&KOMODO_STATEJOURNAL,1);
+    if ( KOMODO_SIGNEDJOURNAL.fp != 0 )
+        komodo_journal_commit(&KOMODO_SIGNEDJOURNAL,1);
+}
+
+void komodo_signedmask_append(int32_t height,uint64_t signedmask)
+{
+    struct komodo_journal *jp = &KOMODO_SIGNEDJOURNAL;
+    if ( jp->fp == 0 )
+    {
+        char fname[512];
+        komodo_statefname(fname,ASSETCHAINS_SYMBOL,(char *)"signedmasks");
+        if ( (jp->fp= fopen(fname,"rb+")) == 0 )
+            jp->fp = fopen(fname,"wb");
+        else fseek(jp->fp,0,SEEK_END);
+    }
+    if ( jp->fp != 0 )
+    {
+        komodo_journal_write(jp,&height,sizeof(height));
+        komodo_journal_write(jp,&signedmask,sizeof(signedmask));
+    }
+}
+
 void komodo_stateupdate(int32_t height,uint8_t notarypubs[][33],uint8_t numnotaries,uint8_t notaryid,uint256 txhash,uint64_t voutmask,uint8_t numvouts,uint32_t *pvals,uint8_t numpvals,int32_t KMDheight,uint32_t KMDtimestamp,uint64_t opretvalue,uint8_t *opretbuf,uint16_t opretlen,uint16_t vout,uint256 MoM,int32_t MoMdepth)
 {
-    static FILE *fp; static int32_t errs,didinit; static uint256 zero;
-    struct komodo_state *sp; char fname[512],symbol[KOMODO_ASSETCHAIN_MAXLEN],dest[KOMODO_ASSETCHAIN_MAXLEN]; int32_t retval,ht,func; uint8_t num,pubkeys[64][33];
+    static int32_t didinit; static uint256 zero; FILE *fp; struct komodo_journal *jp = &KOMODO_STATEJOURNAL;
+    struct komodo_state *sp; char fname[512],symbol[KOMODO_ASSETCHAIN_MAXLEN],dest[KOMODO_ASSETCHAIN_MAXLEN]; int32_t retval,ht,func; long snappos; uint8_t num,pubkeys[64][33];
     if ( didinit == 0 )
     {
         portable_mutex_init(&KOMODO_KV_mutex);
@@ -365,11 +520,15 @@ void komodo_stateupdate(int32_t height,uint8_t notarypubs[][33],uint8_t numnotar
         return;
     }
     //printf("[%s] (%s) -> (%s)\n",ASSETCHAINS_SYMBOL,symbol,dest);
-    if ( fp == 0 )
+    if ( jp->fp == 0 )
     {
         komodo_statefname(fname,ASSETCHAINS_SYMBOL,(char *)"komodostate");
         if ( (fp= fopen(fname,"rb+")) != 0 )
         {
+            fseek(fp,0,SEEK_END);
+            snappos = komodo_snapshot_pos(fp,ftell(fp));
+            rewind(fp);
+            komodo_staterecover(fp,fname,snappos);
             if ( (retval= komodo_faststateinit(sp,fname,symbol,dest)) > 0 )
                 fseek(fp,0,SEEK_END);
             else
@@ -379,6 +538,7 @@ void komodo_stateupdate(int32_t height,uint8_t notarypubs[][33],uint8_t numnotar
                     ;
             }
         } else fp = fopen(fname,"wb+");
+        jp->fp = fp;
         KOMODO_INITDONE = (uint32_t)time(NULL);
     }
     if ( height <= 0 )
@@ -386,74 +546,57 @@ void komodo_stateupdate(int32_t height,uint8_t notarypubs[][33],uint8_t numnotar
         //printf("early return: stateupdate height.%d\n",height);
         return;
     }
-    if ( fp != 0 ) // write out funcid, height, other fields, call side effect function
+    if ( jp->fp != 0 ) // format funcid, height, other fields into the journal, call side effect function
     {
-        //printf("fpos.%ld ",ftell(fp));
         if ( KMDheight != 0 )
         {
             if ( KMDtimestamp != 0 )
             {
-                fputc('T',fp);
-                if ( fwrite(&height,1,sizeof(height),fp) != sizeof(height) )
-                    errs++;
-                if ( fwrite(&KMDheight,1,sizeof(KMDheight),fp) != sizeof(KMDheight) )
-                    errs++;
-                if ( fwrite(&KMDtimestamp,1,sizeof(KMDtimestamp),fp) != sizeof(KMDtimestamp) )
-                    errs++;
+                komodo_journal_putc(jp,'T');
+                komodo_journal_write(jp,&height,sizeof(height));
+                komodo_journal_write(jp,&KMDheight,sizeof(KMDheight));
+                komodo_journal_write(jp,&KMDtimestamp,sizeof(KMDtimestamp));
             }
             else
             {
-                fputc('K',fp);
-                if ( fwrite(&height,1,sizeof(height),fp) != sizeof(height) )
-                    errs++;
-                if ( fwrite(&KMDheight,1,sizeof(KMDheight),fp) != sizeof(KMDheight) )
-                    errs++;
+                komodo_journal_putc(jp,'K');
+                komodo_journal_write(jp,&height,sizeof(height));
+                komodo_journal_write(jp,&KMDheight,sizeof(KMDheight));
             }
             komodo_eventadd_kmdheight(sp,symbol,height,KMDheight,KMDtimestamp);
         }
         else if ( opretbuf != 0 && opretlen > 0 )
         {
             uint16_t olen = opretlen;
-            fputc('R',fp);
-            if ( fwrite(&height,1,sizeof(height),fp) != sizeof(height) )
-                errs++;
-            if ( fwrite(&txhash,1,sizeof(txhash),fp) != sizeof(txhash) )
-                errs++;
-            if ( fwrite(&vout,1,sizeof(vout),fp) != sizeof(vout) )
-                errs++;
-            if ( fwrite(&opretvalue,1,sizeof(opretvalue),fp) != sizeof(opretvalue) )
-                errs++;
-            if ( fwrite(&olen,1,sizeof(olen),fp) != olen )
-                errs++;
-            if ( fwrite(opretbuf,1,olen,fp) != olen )
-                errs++;
+            komodo_journal_putc(jp,'R');
+            komodo_journal_write(jp,&height,sizeof(height));
+            komodo_journal_write(jp,&txhash,sizeof(txhash));
+            komodo_journal_write(jp,&vout,sizeof(vout));
+            komodo_journal_write(jp,&opretvalue,sizeof(opretvalue));
+            komodo_journal_write(jp,&olen,sizeof(olen));
+            komodo_journal_write(jp,opretbuf,olen);
 //printf("ht.%d R opret[%d] sp.%p\n",height,olen,sp);
             //komodo_opreturn(height,opretvalue,opretbuf,olen,txhash,vout);
             komodo_eventadd_opreturn(sp,symbol,height,txhash,opretvalue,vout,opretbuf,olen);
         }
         else if ( notarypubs != 0 && numnotaries > 0 )
         {
-            printf("ht.%d func P[%d] errs.%d\n",height,numnotaries,errs);
-            fputc('P',fp);
-            if ( fwrite(&height,1,sizeof(height),fp) != sizeof(height) )
-                errs++;
-            fputc(numnotaries,fp);
-            if ( fwrite(notarypubs,33,numnotaries,fp) != numnotaries )
-                errs++;
+            printf("ht.%d func P[%d]\n",height,numnotaries);
+            komodo_journal_putc(jp,'P');
+            komodo_journal_write(jp,&height,sizeof(height));
+            komodo_journal_putc(jp,numnotaries);
+            komodo_journal_write(jp,notarypubs,33 * numnotaries);
             komodo_eventadd_pubkeys(sp,symbol,height,numnotaries,notarypubs);
         }
         else if ( voutmask != 0 && numvouts > 0 )
         {
             //printf("ht.%d func U %d %d errs.%d hashsize.%ld\n",height,numvouts,notaryid,errs,sizeof(txhash));
-            fputc('U',fp);
-            if ( fwrite(&height,1,sizeof(height),fp) != sizeof(height) )
-                errs++;
-            fputc(numvouts,fp);
-            fputc(notaryid,fp);
-            if ( fwrite(&voutmask,1,sizeof(voutmask),fp) != sizeof(voutmask) )
-                errs++;
-            if ( fwrite(&txhash,1,sizeof(txhash),fp) != sizeof(txhash) )
-                errs++;
+            komodo_journal_putc(jp,'U');
+            komodo_journal_write(jp,&height,sizeof(height));
+            komodo_journal_putc(jp,numvouts);
+            komodo_journal_putc(jp,notaryid);
+            komodo_journal_write(jp,&voutmask,sizeof(voutmask));
+            komodo_journal_write(jp,&txhash,sizeof(txhash));
             //komodo_eventadd_utxo(sp,symbol,height,notaryid,txhash,voutmask,numvouts);
         }
         else if ( pvals != 0 && numpvals > 0 )
@@ -464,12 +607,10 @@ void komodo_stateupdate(int32_t height,uint8_t notarypubs[][33],uint8_t numnotar
                     nonz++;
             if ( nonz >= 32 )
             {
-                fputc('V',fp);
-                if ( fwrite(&height,1,sizeof(height),fp) != sizeof(height) )
-                    errs++;
-                fputc(numpvals,fp);
-                if ( fwrite(pvals,sizeof(uint32_t),numpvals,fp) != numpvals )
-                    errs++;
+                komodo_journal_putc(jp,'V');
+                komodo_journal_write(jp,&height,sizeof(height));
+                komodo_journal_putc(jp,numpvals);
+                komodo_journal_write(jp,pvals,sizeof(uint32_t) * numpvals);
                 komodo_eventadd_pricefeed(sp,symbol,height,pvals,numpvals);
                 //printf("ht.%d V numpvals[%d]\n",height,numpvals);
             }
@@ -481,33 +622,28 @@ void komodo_stateupdate(int32_t height,uint8_t notarypubs[][33],uint8_t numnotar
             if ( sp != 0 )
             {
                 if ( sp->MoMdepth > 0 && sp->MoM != zero )
-                    fputc('M',fp);
-                else fputc('N',fp);
-                if ( fwrite(&height,1,sizeof(height),fp) != sizeof(height) )
-                    errs++;
-                if ( fwrite(&sp->NOTARIZED_HEIGHT,1,sizeof(sp->NOTARIZED_HEIGHT),fp) != sizeof(sp->NOTARIZED_HEIGHT) )
-                    errs++;
-                if ( fwrite(&sp->NOTARIZED_HASH,1,sizeof(sp->NOTARIZED_HASH),fp) != sizeof(sp->NOTARIZED_HASH) )
-                    errs++;
-                if ( fwrite(&sp->NOTARIZED_DESTTXID,1,sizeof(sp->NOTARIZED_DESTTXID),fp) != sizeof(sp->NOTARIZED_DESTTXID) )
-                    errs++;
+                    komodo_journal_putc(jp,'M');
+                else komodo_journal_putc(jp,'N');
+                komodo_journal_write(jp,&height,sizeof(height));
+                komodo_journal_write(jp,&sp->NOTARIZED_HEIGHT,sizeof(sp->NOTARIZED_HEIGHT));
+                komodo_journal_write(jp,&sp->NOTARIZED_HASH,sizeof(sp->NOTARIZED_HASH));
+                komodo_journal_write(jp,&sp->NOTARIZED_DESTTXID,sizeof(sp->NOTARIZED_DESTTXID));
                 if ( sp->MoMdepth > 0 && sp->MoM != zero )
                 {
-                    if ( fwrite(&sp->MoM,1,sizeof(sp->MoM),fp) != sizeof(sp->MoM) )
-                        errs++;
-                    if ( fwrite(&sp->MoMdepth,1,sizeof(sp->MoMdepth),fp) != sizeof(sp->MoMdepth) )
-                        errs++;
+                    komodo_journal_write(jp,&sp->MoM,sizeof(sp->MoM));
+                    komodo_journal_write(jp,&sp->MoMdepth,sizeof(sp->MoMdepth));
                 }
                 komodo_eventadd_notarized(sp,symbol,height,dest,sp->NOTARIZED_HASH,sp->NOTARIZED_DESTTXID,sp->NOTARIZED_HEIGHT,sp->MoM,sp->MoMdepth);
             }
         }
-        fflush(fp);
+        if ( KOMODO_CONNECTING == 0 )
+            komodo_stateflush(sp);
     }
 }
 
 int32_t komodo_voutupdate(int32_t *isratificationp,int32_t notaryid,uint8_t *scriptbuf,int32_t scriptlen,int32_t height,uint256 txhash,int32_t i,int32_t j,uint64_t *voutmaskp,int32_t *specialtxp,int32_t *notarizedheightp,uint64_t value,int32_t notarized,uint64_t signedmask,uint32_t timestamp)
 {
-    static uint256 zero; static FILE *signedfp;
+    static uint256 zero;
     int32_t opretlen,nid,k,len = 0; uint256 kmdtxid,desttxid; uint8_t crypto777[33]; struct komodo_state *sp; char symbol[KOMODO_ASSETCHAIN_MAXLEN],dest[KOMODO_ASSETCHAIN_MAXLEN];
     if ( (sp= komodo_stateptr(symbol,dest)) == 0 )
         return(-1);
@@ -606,20 +742,7 @@ int32_t komodo_voutupdate(int32_t *isratificationp,int32_t notaryid,uint8_t *scr
                     printf("[%s] ht.%d NOTARIZED.%d %s.%s %sTXID.%s lens.(%d %d) MoM.%s %d\n",ASSETCHAINS_SYMBOL,height,*notarizedheightp,ASSETCHAINS_SYMBOL[0]==0?"KMD":ASSETCHAINS_SYMBOL,kmdtxid.ToString().c_str(),ASSETCHAINS_SYMBOL[0]==0?"BTC":"KMD",desttxid.ToString().c_str(),opretlen,len,sp->MoM.ToString().c_str(),sp->MoMdepth);
                 if ( ASSETCHAINS_SYMBOL[0] == 0 )
                 {
-                    if ( signedfp == 0 )
-                    {
-                        char fname[512];
-                        komodo_statefname(fname,ASSETCHAINS_SYMBOL,(char *)"signedmasks");
-                        if ( (signedfp= fopen(fname,"rb+")) == 0 )
-                            signedfp = fopen(fname,"wb");
-                        else fseek(signedfp,0,SEEK_END);
-                    }
-                    if ( signedfp != 0 )
-                    {
-                        fwrite(&height,1,sizeof(height),signedfp);
-                        fwrite(&signedmask,1,sizeof(signedmask),signedfp);
-                        fflush(signedfp);
-                    }
+                    komodo_signedmask_append(height,signedmask);
                     if ( opretlen > len && scriptbuf[len] == 'A' )
                     {
                         //for (i=0; i<opretlen-len; i++)
@@ -689,7 +812,21 @@ int32_t komodo_notarycmp(uint8_t *scriptPubKey,int32_t scriptlen,uint8_t pubkeys
     return(-1);
 }
 
-void komodo_connectblock(CBlockIndex *pindex,CBlock& block)
+int32_t komodo_undo_scriptPubKey(uint8_t *scriptPubKey,int32_t maxsize,CBlockUndo *blockundo,int32_t txi,int32_t vini)
+{
+    int32_t i,m; uint8_t *ptr;
+    // spent prevouts are captured by UpdateCoins, tx 0 (coinbase) has no undo entry
+    if ( blockundo == 0 || txi <= 0 || txi > blockundo->vtxundo.size() || vini < 0 || vini >= blockundo->vtxundo[txi-1].vprevout.size() )
+        return(-1);
+    const CScript &script = blockundo->vtxundo[txi-1].vprevout[vini].txout.scriptPubKey;
+    ptr = (uint8_t *)script.data();
+    m = script.size();
+    for (i=0; i<maxsize&&i<m; i++)
+        scriptPubKey[i] = ptr[i];
+    return(i);
+}
+
+void komodo_connectblock(CBlockIndex *pindex,CBlock& block,CBlockUndo *blockundo)
 {
     static int32_t hwmheight;
     uint64_t signedmask,voutmask; char symbol[KOMODO_ASSETCHAIN_MAXLEN],dest[KOMODO_ASSETCHAIN_MAXLEN]; struct komodo_state *sp;
@@ -703,6 +840,7 @@ void komodo_connectblock(CBlockIndex *pindex,CBlock& block)
         fprintf(stderr,"unexpected null komodostateptr.[%s]\n",ASSETCHAINS_SYMBOL);
         return;
     }
+    KOMODO_CONNECTING = 1; // stateupdate only appends to the journal until the whole block is in
     //fprintf(stderr,"%s connect.%d\n",ASSETCHAINS_SYMBOL,pindex->nHeight);
     numnotaries = komodo_notaries(pubkeys,pindex->nHeight,pindex->GetBlockTime());
     calc_rmd160_sha256(rmd160,pubkeys[0],33);
@@ -732,7 +870,9 @@ void komodo_connectblock(CBlockIndex *pindex,CBlock& block)
             {
                 if ( i == 0 && j == 0 )
                     continue;
-                if ( (scriptlen= gettxout_scriptPubKey(scriptPubKey,sizeof(scriptPubKey),block.vtx[i].vin[j].prevout.hash,block.vtx[i].vin[j].prevout.n)) > 0 )
+                if ( (scriptlen= komodo_undo_scriptPubKey(scriptPubKey,sizeof(scriptPubKey),blockundo,i,j)) < 0 )
+                    scriptlen = gettxout_scriptPubKey(scriptPubKey,sizeof(scriptPubKey),block.vtx[i].vin[j].prevout.hash,block.vtx[i].vin[j].prevout.n);
+                if ( scriptlen > 0 )
                 {
                     if ( (k= komodo_notarycmp(scriptPubKey,scriptlen,pubkeys,numnotaries,rmd160)) >= 0 )
                         signedmask |= (1LL << k);
@@ -752,21 +892,7 @@ void komodo_connectblock(CBlockIndex *pindex,CBlock& block)
             {
                 if ( ASSETCHAINS_SYMBOL[0] != 0 )
                 {
-                    static FILE *signedfp;
-                    if ( signedfp == 0 )
-                    {
-                        char fname[512];
-                        komodo_statefname(fname,ASSETCHAINS_SYMBOL,(char *)"signedmasks");
-                        if ( (signedfp= fopen(fname,"rb+")) == 0 )
-                            signedfp = fopen(fname,"wb");
-                        else fseek(signedfp,0,SEEK_END);
-                    }
-                    if ( signedfp != 0 )
-                    {
-                        fwrite(&height,1,sizeof(height),signedfp);
-                        fwrite(&signedmask,1,sizeof(signedmask),signedfp);
-                        fflush(signedfp);
-                    }
+                    komodo_signedmask_append(height,signedmask);
                      printf("[%s] ht.%d txi.%d signedmask.%llx numvins.%d numvouts.%d <<<<<<<<<<<  notarized\n",ASSETCHAINS_SYMBOL,height,i,(long long)signedmask,numvins,numvouts);
                 }
                 notarized = 1;
@@ -855,7 +981,10 @@ void komodo_connectblock(CBlockIndex *pindex,CBlock& block)
             printf("%s ht.%d\n",ASSETCHAINS_SYMBOL[0] == 0 ? "KMD" : ASSETCHAINS_SYMBOL,height);
         if ( pindex->nHeight == hwmheight )
             komodo_stateupdate(height,0,0,0,zero,0,0,0,0,height,(uint32_t)pindex->nTime,0,0,0,0,zero,0);
+        komodo_kvprune(height);
     } else fprintf(stderr,"komodo_connectblock: unexpected null pindex\n");
+    KOMODO_CONNECTING = 0;
+    komodo_stateflush(sp);
     //KOMODO_INITDONE = (uint32_t)time(NULL);
     //fprintf(stderr,"%s end connect.%d\n",ASSETCHAINS_SYMBOL,pindex->nHeight);
 }
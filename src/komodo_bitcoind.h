@@ -27,6 +27,7 @@
 
 int32_t komodo_notaries(uint8_t pubkeys[64][33],int32_t height,uint32_t timestamp);
 int32_t komodo_electednotary(int32_t *numnotariesp,uint8_t *pubkey33,int32_t height,uint32_t timestamp);
+extern int32_t KOMODO_LOADINGBLOCKS;
 
 //#define issue_curl(cmdstr) bitcoind_RPC(0,(char *)"curl",(char *)"http://127.0.0.1:7776",0,0,(char *)(cmdstr))
 
@@ -144,6 +145,50 @@ char *post_process_bitcoind_RPC(char *debugstr,char *command,char *rpcstr,char *
  *
  ************************************************************************/
 
+#define KOMODO_RPCPOOL_MAX 16
+struct komodo_rpchandle { CURL *curl; char url[256]; };
+struct komodo_rpchandle KOMODO_RPCPOOL[KOMODO_RPCPOOL_MAX]; int32_t KOMODO_NUMRPCPOOL;
+pthread_mutex_t KOMODO_RPCPOOL_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+// an idle handle that last talked to url keeps its connection open, so the next call skips the connect
+CURL *komodo_rpchandle_get(char *url)
+{
+    CURL *curl = 0; int32_t i;
+    pthread_mutex_lock(&KOMODO_RPCPOOL_mutex);
+    for (i=KOMODO_NUMRPCPOOL-1; i>=0; i--)
+    {
+        if ( strcmp(KOMODO_RPCPOOL[i].url,url) == 0 )
+        {
+            curl = KOMODO_RPCPOOL[i].curl;
+            KOMODO_RPCPOOL[i] = KOMODO_RPCPOOL[--KOMODO_NUMRPCPOOL];
+            break;
+        }
+    }
+    pthread_mutex_unlock(&KOMODO_RPCPOOL_mutex);
+    if ( curl != 0 )
+        curl_easy_reset(curl); // clears the options, not the open connection
+    else curl = curl_easy_init();
+    return(curl);
+}
+
+void komodo_rpchandle_put(CURL *curl,char *url,int32_t reusable)
+{
+    if ( reusable != 0 && strlen(url) < sizeof(KOMODO_RPCPOOL[0].url) )
+    {
+        pthread_mutex_lock(&KOMODO_RPCPOOL_mutex);
+        if ( KOMODO_NUMRPCPOOL < KOMODO_RPCPOOL_MAX )
+        {
+            KOMODO_RPCPOOL[KOMODO_NUMRPCPOOL].curl = curl;
+            strcpy(KOMODO_RPCPOOL[KOMODO_NUMRPCPOOL].url,url);
+            KOMODO_NUMRPCPOOL++;
+            curl = 0;
+        }
+        pthread_mutex_unlock(&KOMODO_RPCPOOL_mutex);
+    }
+    if ( curl != 0 )
+        curl_easy_cleanup(curl);
+}
+
 char *bitcoind_RPC(char **retstrp,char *debugstr,char *url,char *userpass,char *command,char *params)
 {
     static int didinit,count,count2; static double elapsedsum,elapsedsum2;
@@ -166,7 +211,7 @@ try_again:
     if ( retstrp != 0 )
         *retstrp = 0;
     starttime = OS_milliseconds();
-    curl_handle = curl_easy_init();
+    curl_handle = komodo_rpchandle_get(url);
     init_string(&s);
     headers = curl_slist_append(0,"Expect:");
 
@@ -177,6 +222,8 @@ try_again:
     curl_easy_setopt(curl_handle,CURLOPT_WRITEDATA,		&s); 			// we pass our 's' struct to the callback
     curl_easy_setopt(curl_handle,CURLOPT_NOSIGNAL,		1L);   			// supposed to fix "Alarm clock" and long jump crash
 	curl_easy_setopt(curl_handle,CURLOPT_NOPROGRESS,	1L);			// no progress callback
+    curl_easy_setopt(curl_handle,CURLOPT_CONNECTTIMEOUT,10L);
+    curl_easy_setopt(curl_handle,CURLOPT_TCP_KEEPALIVE,1L);
     if ( strncmp(url,"https",5) == 0 )
     {
         curl_easy_setopt(curl_handle,CURLOPT_SSL_VERIFYPEER,0);
@@ -212,7 +259,7 @@ try_again:
     //laststart = milliseconds();
     res = curl_easy_perform(curl_handle);
     curl_slist_free_all(headers);
-    curl_easy_cleanup(curl_handle);
+    komodo_rpchandle_put(curl_handle,url,res == CURLE_OK);
     if ( databuf != 0 ) // clean up temporary buffer
     {
         free(databuf);
@@ -405,11 +452,26 @@ int32_t notarizedtxid_height(char *dest,char *txidstr,int32_t *kmdnotarized_heig
     return(txid_height);
 }
 
-int32_t komodo_verifynotarizedscript(int32_t height,uint8_t *script,int32_t len,uint256 NOTARIZED_HASH)
+// hash, height and MoM a notarization opreturn on the dest chain commits to
+int32_t komodo_notarizedscript_data(int32_t *heightp,uint256 *hashp,uint256 *MoMp,uint8_t *script,int32_t len)
 {
-    int32_t i; uint256 hash; char params[256];
+    int32_t i,offset = 2 + 32 + sizeof(*heightp);
+    memset(MoMp,0,sizeof(*MoMp));
+    if ( len < offset )
+        return(-1);
     for (i=0; i<32; i++)
-        ((uint8_t *)&hash)[i] = script[2+i];
+        ((uint8_t *)hashp)[i] = script[2+i];
+    iguana_rwnum(0,&script[2+32],sizeof(*heightp),(uint8_t *)heightp);
+    while ( offset < len && script[offset] != 0 )
+        offset++;
+    if ( ++offset+32 <= len )
+        iguana_rwbignum(0,&script[offset],32,(uint8_t *)MoMp);
+    return(0);
+}
+
+int32_t komodo_verifynotarizedhash(int32_t height,uint256 hash,uint256 NOTARIZED_HASH)
+{
+    int32_t i;
     if ( hash == NOTARIZED_HASH )
         return(0);
     for (i=0; i<32; i++)
@@ -421,9 +483,17 @@ int32_t komodo_verifynotarizedscript(int32_t height,uint8_t *script,int32_t len,
     return(-1);
 }
 
+int32_t komodo_verifynotarizedscript(int32_t height,uint8_t *script,int32_t len,uint256 NOTARIZED_HASH)
+{
+    int32_t i; uint256 hash;
+    for (i=0; i<32; i++)
+        ((uint8_t *)&hash)[i] = script[2+i];
+    return(komodo_verifynotarizedhash(height,hash,NOTARIZED_HASH));
+}
+
 int32_t komodo_verifynotarization(char *symbol,char *dest,int32_t height,int32_t NOTARIZED_HEIGHT,uint256 NOTARIZED_HASH,uint256 NOTARIZED_DESTTXID)
 {
-    char params[256],*jsonstr,*hexstr; uint8_t *script,_script[8192]; int32_t n,len,retval = -1; cJSON *json,*txjson,*vouts,*vout,*skey;
+    char params[256],*jsonstr,*hexstr; uint8_t *script,_script[8192]; int32_t n,len,ht,retval = -1; uint256 hash,MoM; cJSON *json,*txjson,*vouts,*vout,*skey;
     script = _script;
     /*params[0] = '[';
     params[1] = '"';
@@ -435,6 +505,9 @@ int32_t komodo_verifynotarization(char *symbol,char *dest,int32_t height,int32_t
         return(0);
     if ( 0 && ASSETCHAINS_SYMBOL[0] != 0 )
         printf("[%s] src.%s dest.%s params.[%s] ht.%d notarized.%d\n",ASSETCHAINS_SYMBOL,symbol,dest,params,height,NOTARIZED_HEIGHT);
+    if ( pblocktree != 0 && pblocktree->ReadNotarization(dest,NOTARIZED_DESTTXID,ht,hash,MoM) != 0 ) // a desttxid never changes what it notarized
+        return(komodo_verifynotarizedhash(height,hash,NOTARIZED_HASH));
+    jsonstr = 0;
     if ( strcmp(dest,"KMD") == 0 )
     {
         if ( KMDUSERPASS[0] != 0 )
@@ -488,6 +561,8 @@ int32_t komodo_verifynotarization(char *symbol,char *dest,int32_t height,int32_t
                             script += 2;
                             len -= 2;
                         }
+                        if ( pblocktree != 0 && komodo_notarizedscript_data(&ht,&hash,&MoM,script,len) == 0 )
+                            pblocktree->WriteNotarization(dest,NOTARIZED_DESTTXID,ht,hash,MoM);
                         retval = komodo_verifynotarizedscript(height,script,len,NOTARIZED_HASH);
                     }
                 }
@@ -715,9 +790,44 @@ uint32_t komodo_heightstamp(int32_t height)
     return(0);
 }
 
+#define KOMODO_NOTARYID_UNKNOWN -2 // pubkey33 is cached but the notary set was not loaded yet when it was
+
+void komodo_blockindex_notaryid(CBlockIndex *pindex)
+{
+    int32_t num,i; uint8_t pubkeys[64][33];
+    if ( KOMODO_LOADINGBLOCKS != 0 ) // block index load runs before komodostate is replayed, notaries may still be missing
+    {
+        pindex->notaryid = KOMODO_NOTARYID_UNKNOWN;
+        return;
+    }
+    pindex->notaryid = -1;
+    if ( (num= komodo_notaries(pubkeys,(int32_t)pindex->nHeight,(uint32_t)pindex->nTime)) > 0 )
+    {
+        for (i=0; i<num; i++)
+        {
+            if ( memcmp(pubkeys[i],pindex->pubkey33,33) == 0 )
+            {
+                pindex->notaryid = i;
+                break;
+            }
+        }
+    }
+}
+
+// caches the coinbase pubkey and its notaryid in pindex, CDiskBlockIndex persists both
+void komodo_blockindex_pubkey33(uint8_t *pubkey33,CBlockIndex *pindex,CBlock& block)
+{
+    komodo_block2pubkey33(pubkey33,block);
+    if ( (pubkey33[0] == 2 || pubkey33[0] == 3) )
+    {
+        memcpy(pindex->pubkey33,pubkey33,33);
+        komodo_blockindex_notaryid(pindex);
+    } else pindex->notaryid = -1;
+}
+
 void komodo_index2pubkey33(uint8_t *pubkey33,CBlockIndex *pindex,int32_t height)
 {
-    CBlock block; int32_t num,i; uint8_t pubkeys[64][33];
+    CBlock block;
     //komodo_init(height);
     memset(pubkey33,0,33);
     if ( pindex != 0 )
@@ -728,25 +838,7 @@ void komodo_index2pubkey33(uint8_t *pubkey33,CBlockIndex *pindex,int32_t height)
             return;
         }
         if ( komodo_blockload(block,pindex) == 0 )
-        {
-            komodo_block2pubkey33(pubkey33,block);
-            if ( (pubkey33[0] == 2 || pubkey33[0] == 3) )
-            {
-                memcpy(pindex->pubkey33,pubkey33,33);
-                if ( (num= komodo_notaries(pubkeys,(int32_t)pindex->nHeight,(uint32_t)pindex->nTime)) > 0 )
-                {
-                    pindex->notaryid = -1;
-                    for (i=0; i<num; i++)
-                    {
-                        if ( memcmp(pubkeys[i],pubkey33,33) == 0 )
-                        {
-                            pindex->notaryid = i;
-                            break;
-                        }
-                    }
-                }
-            } else pindex->notaryid = -1;
-       }
+            komodo_blockindex_pubkey33(pubkey33,pindex,block);
     }
     else
     {
@@ -759,22 +851,26 @@ void komodo_index2pubkey33(uint8_t *pubkey33,CBlockIndex *pindex,int32_t height)
 {
     CBlock block;
     if ( komodo_blockload(block,pindex) == 0 )
-        komodo_connectblock(pindex,block);
+        komodo_connectblock(pindex,block,0);
 }*/
 
 
-int8_t komodo_minerid(int32_t height,uint8_t *pubkey33)
+int8_t komodo_pindex_minerid(CBlockIndex *pindex,int32_t height,uint8_t *pubkey33)
 {
-    int32_t num,i,numnotaries; CBlockIndex *pindex; uint32_t timestamp=0; uint8_t _pubkey33[33],pubkeys[64][33];
-    if ( (pindex= chainActive[height]) != 0 )
+    int32_t num,i,numnotaries; uint32_t timestamp=0; uint8_t _pubkey33[33],pubkeys[64][33];
+    if ( pindex != 0 )
     {
         if ( (pindex->pubkey33[0] == 2 || pindex->pubkey33[0] == 3) )
         {
             if ( pubkey33 != 0 )
                 memcpy(pubkey33,pindex->pubkey33,33);
-            return(pindex->notaryid);
+            if ( pindex->notaryid == KOMODO_NOTARYID_UNKNOWN )
+                komodo_blockindex_notaryid(pindex);
+            if ( pindex->notaryid != KOMODO_NOTARYID_UNKNOWN )
+                return(pindex->notaryid);
+            pubkey33 = pindex->pubkey33; // still loading, look it up without caching
         }
-        if ( pubkey33 != 0 )
+        else if ( pubkey33 != 0 )
             komodo_index2pubkey33(pubkey33,pindex,height);
         timestamp = pindex->GetBlockTime();
         if ( (num= komodo_notaries(pubkeys,height,timestamp)) > 0 )
@@ -787,30 +883,98 @@ int8_t komodo_minerid(int32_t height,uint8_t *pubkey33)
     return(komodo_electednotary(&numnotaries,pubkey33,height,timestamp));
 }
 
+int8_t komodo_minerid(int32_t height,uint8_t *pubkey33)
+{
+    return(komodo_pindex_minerid(chainActive[height],height,pubkey33));
+}
+
+// ring of recent miner ids by height, filled by ConnectTip and on demand, each slot is only
+// trusted for the exact pindex and notary set it was computed for
+#define KOMODO_MINERWINDOW 128
+struct komodo_minerslot { uint32_t seq; int32_t gen,mid; CBlockIndex *pindex; uint8_t pubkey33[33]; }; // seq is odd while a writer fills the slot, like komodo_rtslot
+struct komodo_minerslot Komodo_minerwindow[KOMODO_MINERWINDOW];
+
+// seqlock read of a slot, 0 if it holds something else or is being written
+int32_t komodo_minerslot_get(int32_t *midp,uint8_t *pubkey33,struct komodo_minerslot *sp,CBlockIndex *pindex,int32_t gen)
+{
+    uint32_t seq; int32_t mid; uint8_t tmp[33];
+    if ( ((seq= __atomic_load_n(&sp->seq,__ATOMIC_ACQUIRE)) & 1) != 0 )
+        return(0);
+    if ( __atomic_load_n(&sp->pindex,__ATOMIC_RELAXED) != pindex || __atomic_load_n(&sp->gen,__ATOMIC_RELAXED) != gen )
+        return(0);
+    mid = __atomic_load_n(&sp->mid,__ATOMIC_RELAXED);
+    memcpy(tmp,sp->pubkey33,33);
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    if ( __atomic_load_n(&sp->seq,__ATOMIC_RELAXED) != seq )
+        return(0);
+    memcpy(pubkey33,tmp,33);
+    *midp = mid;
+    return(1);
+}
+
+// a writer claims the slot by making seq odd, if another one got there first this result is simply not cached
+void komodo_minerslot_set(struct komodo_minerslot *sp,CBlockIndex *pindex,int32_t gen,int32_t mid,uint8_t *pubkey33)
+{
+    uint32_t seq;
+    if ( ((seq= __atomic_load_n(&sp->seq,__ATOMIC_RELAXED)) & 1) != 0 || __atomic_compare_exchange_n(&sp->seq,&seq,seq + 1,0,__ATOMIC_RELAXED,__ATOMIC_RELAXED) == 0 )
+        return;
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    __atomic_store_n(&sp->pindex,pindex,__ATOMIC_RELAXED);
+    __atomic_store_n(&sp->gen,gen,__ATOMIC_RELAXED);
+    __atomic_store_n(&sp->mid,mid,__ATOMIC_RELAXED);
+    memcpy(sp->pubkey33,pubkey33,33);
+    __atomic_store_n(&sp->seq,seq + 2,__ATOMIC_RELEASE);
+}
+
+int32_t komodo_minerwindow_mid(uint8_t *pubkey33,CBlockIndex *pindex)
+{
+    struct komodo_minerslot *sp; int32_t mid,gen;
+    sp = &Komodo_minerwindow[pindex->nHeight & (KOMODO_MINERWINDOW-1)];
+    gen = __atomic_load_n(&KOMODO_NOTARYSET_GEN,__ATOMIC_ACQUIRE);
+    if ( komodo_minerslot_get(&mid,pubkey33,sp,pindex,gen) != 0 )
+        return(mid);
+    if ( pindex->notaryid >= 0 && (pindex->pubkey33[0] == 2 || pindex->pubkey33[0] == 3) )
+    {
+        memcpy(pubkey33,pindex->pubkey33,33);
+        mid = pindex->notaryid;
+    }
+    else
+    {
+        komodo_index2pubkey33(pubkey33,pindex,pindex->nHeight);
+        mid = komodo_pindex_minerid(pindex,pindex->nHeight,pubkey33);
+    }
+    komodo_minerslot_set(sp,pindex,gen,mid,pubkey33);
+    return(mid);
+}
+
+void komodo_minerwindow_connect(CBlockIndex *pindex)
+{
+    uint8_t pubkey33[33];
+    if ( pindex != 0 )
+        komodo_minerwindow_mid(pubkey33,pindex);
+}
+
+void komodo_minerwindow_disconnect(CBlockIndex *pindex)
+{
+    struct komodo_minerslot *sp; uint8_t pubkey33[33];
+    if ( pindex == 0 )
+        return;
+    sp = &Komodo_minerwindow[pindex->nHeight & (KOMODO_MINERWINDOW-1)];
+    memset(pubkey33,0,sizeof(pubkey33));
+    if ( __atomic_load_n(&sp->pindex,__ATOMIC_RELAXED) == pindex ) // best effort, an entry is never wrong for its own pindex
+        komodo_minerslot_set(sp,0,-1,-1,pubkey33);
+}
+
 int32_t komodo_eligiblenotary(uint8_t pubkeys[66][33],int32_t *mids,int32_t *nonzpkeysp,int32_t height)
 {
-    int32_t i,j,duplicate; CBlockIndex *pindex; uint8_t pubkey33[33];
+    int32_t i,duplicate; CBlockIndex *pindex;
     memset(mids,-1,sizeof(*mids)*66);
     for (i=duplicate=0; i<66; i++)
     {
         if ( (pindex= komodo_chainactive(height-i)) != 0 )
         {
-            if ( pindex->notaryid >= 0 && (pindex->pubkey33[0] == 2 || pindex->pubkey33[0] == 3) )
-            {
-                memcpy(pubkeys[i],pindex->pubkey33,33);
-                mids[i] = pindex->notaryid;
+            if ( (mids[i]= komodo_minerwindow_mid(pubkeys[i],pindex)) >= 0 )
                 (*nonzpkeysp)++;
-            }
-            else
-            {
-                komodo_index2pubkey33(pubkey33,pindex,height-i);
-                memcpy(pubkeys[i],pubkey33,33);
-                if ( (mids[i]= komodo_minerid(height-i,pubkey33)) >= 0 )
-                {
-                    //mids[i] = *(int32_t *)pubkey33;
-                    (*nonzpkeysp)++;
-                }
-            }
             if ( mids[0] >= 0 && i > 0 && mids[i] == mids[0] )
                 duplicate++;
         }
@@ -835,7 +999,7 @@ int32_t komodo_minerids(uint8_t *minerids,int32_t height,int32_t width) // depre
 
 int32_t komodo_is_special(int32_t height,uint8_t pubkey33[33],uint32_t timestamp)
 {
-    int32_t i,notaryid=0,minerid,limit,nid; //uint8_t _pubkey33[33];
+    int32_t i,notaryid=0,minerid,limit,nid,era; //uint8_t _pubkey33[33];
     if ( height >= 225000 )
         komodo_chosennotary(&notaryid,height,pubkey33,timestamp);
     if ( height >= 34000 && notaryid >= 0 )
@@ -845,9 +1009,14 @@ int32_t komodo_is_special(int32_t height,uint8_t pubkey33[33],uint32_t timestamp
         else if ( height < 82000 )
             limit = 8;
         else limit = 66;
-        for (i=1; i<limit; i++)
+        for (i=1,era=-1; i<limit; i++)
         {
-            komodo_chosennotary(&nid,height-i,pubkey33,timestamp);
+            // nid only changes across notary eras, which are far wider than limit
+            if ( komodo_notaryera(height-i,timestamp) != era )
+            {
+                era = komodo_notaryera(height-i,timestamp);
+                komodo_chosennotary(&nid,height-i,pubkey33,timestamp);
+            }
             if ( nid == notaryid )
             {
                 if ( (0) && notaryid > 0 )
@@ -934,6 +1103,49 @@ uint32_t komodo_interest_args(uint32_t *txheighttimep,int32_t *txheightp,uint32_
 
 uint64_t komodo_interest(int32_t txheight,uint64_t nValue,uint32_t nLockTime,uint32_t tiptime);
 
+// same as komodo_accrued_interest but with the locktime and height already known from the coins view
+uint64_t komodo_coins_interest(int32_t txheight,uint32_t locktime,uint64_t value,int32_t tipheight)
+{
+    uint32_t tiptime = 0; CBlockIndex *pindex;
+    if ( locktime == 0 || txheight <= 0 || (uint32_t)txheight == MEMPOOL_HEIGHT )
+        return(0);
+    // komodo_interest_args zeroes the tiptime komodo_accrued_interest looks up at tipheight and then takes the tip's, keep that so interest is unchanged
+    if ( (pindex= chainActive.Tip()) != 0 )
+        tiptime = (uint32_t)pindex->nTime;
+    return(komodo_interest(txheight,value,locktime,tiptime));
+}
+
+// only used to fill in coins stored before nLockTime was kept
+int32_t komodo_txlocktime(uint32_t *locktimep,uint256 txid,int32_t height)
+{
+    static CBlock block; static CBlockIndex *blockindex;
+    CTransaction tx; uint256 hashBlock; CBlockIndex *pindex; int32_t i;
+    *locktimep = 0;
+    if ( fTxIndex != 0 && GetTransaction(txid,tx,hashBlock,false) != 0 )
+    {
+        *locktimep = tx.nLockTime;
+        return(0);
+    }
+    if ( (pindex= chainActive[height]) == 0 )
+        return(-1);
+    if ( pindex != blockindex )
+    {
+        blockindex = 0;
+        if ( komodo_blockload(block,pindex) != 0 )
+            return(-1);
+        blockindex = pindex;
+    }
+    for (i=0; i<block.vtx.size(); i++)
+    {
+        if ( block.vtx[i].GetHash() == txid )
+        {
+            *locktimep = block.vtx[i].nLockTime;
+            return(0);
+        }
+    }
+    return(-1);
+}
+
 uint64_t komodo_accrued_interest(int32_t *txheightp,uint32_t *locktimep,uint256 hash,int32_t n,int32_t checkheight,uint64_t checkvalue,int32_t tipheight)
 {
     uint64_t value; uint32_t tiptime=0,txheighttimep; CBlockIndex *pindex;
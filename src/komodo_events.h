@@ -19,24 +19,60 @@
 
 struct komodo_event *komodo_eventadd(struct komodo_state *sp,int32_t height,char *symbol,uint8_t type,uint8_t *data,uint16_t datalen)
 {
-    struct komodo_event *ep=0; uint16_t len = (uint16_t)(sizeof(*ep) + datalen);
+    struct komodo_event *ep=0; struct komodo_eventchunk *chunk; uint16_t len = (uint16_t)(sizeof(*ep) + datalen); int32_t size;
     if ( sp != 0 )
     {
+        size = (len + 7) & ~7;
         portable_mutex_lock(&komodo_mutex);
-        ep = (struct komodo_event *)calloc(1,len);
+        if ( (chunk= sp->Komodo_eventchunks) == 0 || chunk->used+size > KOMODO_EVENTS_CHUNKSIZE )
+        {
+            chunk = (struct komodo_eventchunk *)malloc(sizeof(*chunk) + KOMODO_EVENTS_CHUNKSIZE);
+            chunk->prev = sp->Komodo_eventchunks;
+            chunk->used = 0;
+            sp->Komodo_eventchunks = chunk;
+            sp->Komodo_numchunks++;
+        }
+        ep = (struct komodo_event *)&chunk->space[chunk->used];
+        chunk->used += size;
+        memset(ep,0,sizeof(*ep));
+        ep->prev = sp->Komodo_lastevent;
         ep->len = len;
         ep->height = height;
         ep->type = type;
         strcpy(ep->symbol,symbol);
         if ( datalen != 0 )
             memcpy(ep->space,data,datalen);
-        sp->Komodo_events = (struct komodo_event **)realloc(sp->Komodo_events,(1 + sp->Komodo_numevents) * sizeof(*sp->Komodo_events));
-        sp->Komodo_events[sp->Komodo_numevents++] = ep;
+        sp->Komodo_lastevent = ep;
+        sp->Komodo_numevents++;
         portable_mutex_unlock(&komodo_mutex);
     }
     return(ep);
 }
 
+// truncates the arena back to just before ep, freeing chunks that become empty
+void komodo_event_truncate(struct komodo_state *sp,struct komodo_event *ep)
+{
+    struct komodo_eventchunk *chunk;
+    sp->Komodo_lastevent = ep->prev;
+    sp->Komodo_numevents--;
+    while ( (chunk= sp->Komodo_eventchunks) != 0 )
+    {
+        if ( (uint8_t *)ep >= chunk->space && (uint8_t *)ep < &chunk->space[chunk->used] )
+        {
+            if ( (chunk->used= (int64_t)((uint8_t *)ep - chunk->space)) == 0 )
+            {
+                sp->Komodo_eventchunks = chunk->prev;
+                sp->Komodo_numchunks--;
+                free(chunk);
+            }
+            break;
+        }
+        sp->Komodo_eventchunks = chunk->prev; // ep lives in an older chunk, so this one is empty
+        sp->Komodo_numchunks--;
+        free(chunk);
+    }
+}
+
 void komodo_eventadd_notarized(struct komodo_state *sp,char *symbol,int32_t height,char *dest,uint256 notarized_hash,uint256 notarized_desttxid,int32_t notarizedheight,uint256 MoM,int32_t MoMdepth)
 {
     struct komodo_event_notarized N;
@@ -119,9 +155,56 @@ void komodo_event_undo(struct komodo_state *sp,struct komodo_event *ep)
     }
 }
 
+// events below sp->SNAPSHOT_POS were never added to the arena, replay their komodostate records to find the kmdheight events a rewind to height removes
+// returns the lowest such event height, 0x7fffffff if there is none, or -1 if the records cant be read
+int32_t komodo_snapshot_replay(struct komodo_state *sp,int32_t height)
+{
+    FILE *fp; char fname[512]; uint8_t *buf; int32_t ht,kheight,*heights = 0,num = 0,max = 0,minheight = 0x7fffffff; long len = 0,offset,n,fpos = 0;
+    komodo_statefname(fname,ASSETCHAINS_SYMBOL,(char *)"komodostate");
+    if ( (fp= fopen(fname,"rb")) == 0 )
+        return(-1);
+    buf = (uint8_t *)malloc(1 << 20); // larger than any single record
+    while ( fpos < sp->SNAPSHOT_POS && (n= fread(&buf[len],1,(sp->SNAPSHOT_POS - fpos) < (1 << 20) - len ? (sp->SNAPSHOT_POS - fpos) : (1 << 20) - len,fp)) > 0 )
+    {
+        fpos += n, len += n;
+        for (offset=0; (n= komodo_staterecordlen(&buf[offset],len - offset)) > 0; offset+=n)
+        {
+            if ( buf[offset] != 'K' && buf[offset] != 'T' )
+                continue;
+            memcpy(&ht,&buf[offset+1],sizeof(ht));
+            memcpy(&kheight,&buf[offset+1+sizeof(ht)],sizeof(kheight));
+            if ( kheight > 0 ) // same as komodo_eventadd_kmdheight
+            {
+                if ( num >= max )
+                    heights = (int32_t *)realloc(heights,(max= max + 4096) * sizeof(*heights));
+                heights[num++] = ht;
+            } else while ( num > 0 && heights[num-1] >= ht )
+                num--;
+        }
+        if ( n < 0 )
+            break;
+        memmove(buf,&buf[offset],len - offset);
+        len -= offset;
+    }
+    fclose(fp);
+    free(buf);
+    if ( fpos != sp->SNAPSHOT_POS || n < 0 )
+        minheight = -1;
+    else
+    {
+        while ( num > 0 && heights[num-1] > sp->SNAPSHOT_HEIGHT ) // already undone by an earlier rewind that crossed the snapshot
+            num--;
+        while ( num > 0 && heights[num-1] >= height )
+            minheight = heights[--num];
+    }
+    if ( heights != 0 )
+        free(heights);
+    return(minheight);
+}
+
 void komodo_event_rewind(struct komodo_state *sp,char *symbol,int32_t height)
 {
-    struct komodo_event *ep;
+    struct komodo_event *ep; int32_t crossed,minheight;
     if ( sp != 0 )
     {
         if ( ASSETCHAINS_SYMBOL[0] == 0 && height <= KOMODO_LASTMINED && prevKOMODO_LASTMINED != 0 )
@@ -130,16 +213,27 @@ void komodo_event_rewind(struct komodo_state *sp,char *symbol,int32_t height)
             KOMODO_LASTMINED = prevKOMODO_LASTMINED;
             prevKOMODO_LASTMINED = 0;
         }
-        while ( sp->Komodo_events != 0 && sp->Komodo_numevents > 0 )
+        komodo_kvrewind(height);
+        portable_mutex_lock(&komodo_mutex);
+        while ( (ep= sp->Komodo_lastevent) != 0 )
         {
-            if ( (ep= sp->Komodo_events[sp->Komodo_numevents-1]) != 0 )
-            {
-                if ( ep->height < height )
-                    break;
-                //printf("[%s] undo %s event.%c ht.%d for rewind.%d\n",ASSETCHAINS_SYMBOL,symbol,ep->type,ep->height,height);
-                komodo_event_undo(sp,ep);
-                sp->Komodo_numevents--;
-            }
+            if ( ep->height < height )
+                break;
+            //printf("[%s] undo %s event.%c ht.%d for rewind.%d\n",ASSETCHAINS_SYMBOL,symbol,ep->type,ep->height,height);
+            komodo_event_undo(sp,ep);
+            komodo_event_truncate(sp,ep);
+        }
+        crossed = (sp->Komodo_lastevent == 0 && sp->SNAPSHOT_POS > 0 && height <= sp->SNAPSHOT_HEIGHT);
+        portable_mutex_unlock(&komodo_mutex);
+        if ( crossed != 0 ) // the arena is exhausted and the rest of the rewind is in the snapshot
+        {
+            if ( (minheight= komodo_snapshot_replay(sp,height)) < 0 )
+                fprintf(stderr,"[%s] %s rewind.%d crosses snapshot.%d and its komodostate records cant be replayed\n",ASSETCHAINS_SYMBOL,symbol,height,sp->SNAPSHOT_HEIGHT);
+            portable_mutex_lock(&komodo_mutex);
+            if ( minheight > 0 && minheight <= sp->SAVEDHEIGHT ) // komodo_event_undo of each removed kmdheight event
+                sp->SAVEDHEIGHT = minheight;
+            sp->SNAPSHOT_HEIGHT = height - 1;
+            portable_mutex_unlock(&komodo_mutex);
         }
     }
 }
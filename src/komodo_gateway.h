@@ -50,6 +50,36 @@ void pax_keyset(uint8_t *buf,uint256 txid,uint16_t vout,uint8_t type)
     buf[34] = type;
 }
 
+void komodo_paxpending_compact() // caller holds komodo_mutex
+{
+    int32_t i,j;
+    for (i=j=0; i<NUM_PAX_PENDING; i++)
+    {
+        if ( PAX_PENDING[i]->marked == 0 )
+            PAX_PENDING[j++] = PAX_PENDING[i];
+        else PAX_PENDING[i]->ready = PAX_PENDING[i]->pending = 0;
+    }
+    NUM_PAX_PENDING = j;
+}
+
+void komodo_paxpending(struct pax_transaction *pax) // caller holds komodo_mutex
+{
+    if ( pax->pending != 0 )
+        return;
+    if ( NUM_PAX_PENDING >= MAX_PAX_PENDING )
+    {
+        // komodo_paxtotal does not run before init is done or while not realtime, so marked entries are also dropped here
+        komodo_paxpending_compact();
+        if ( NUM_PAX_PENDING >= MAX_PAX_PENDING/2 )
+        {
+            MAX_PAX_PENDING = MAX_PAX_PENDING == 0 ? 64 : (MAX_PAX_PENDING << 1);
+            PAX_PENDING = (struct pax_transaction **)realloc(PAX_PENDING,sizeof(*PAX_PENDING) * MAX_PAX_PENDING);
+        }
+    }
+    pax->pending = 1;
+    PAX_PENDING[NUM_PAX_PENDING++] = pax;
+}
+
 struct pax_transaction *komodo_paxfind(uint256 txid,uint16_t vout,uint8_t type)
 {
     struct pax_transaction *pax; uint8_t buf[35];
@@ -87,7 +117,8 @@ struct pax_transaction *komodo_paxmark(int32_t height,uint256 txid,uint16_t vout
     }
     if ( pax != 0 )
     {
-        pax->marked = mark;
+        if ( (pax->marked= mark) == 0 )
+            komodo_paxpending(pax);
         //if ( height > 214700 || pax->height > 214700 )
         //    printf("mark ht.%d %.8f %.8f\n",pax->height,dstr(pax->komodoshis),dstr(pax->fiatoshis));
         
@@ -123,6 +154,7 @@ void komodo_gateway_deposit(char *coinaddr,uint64_t value,char *symbol,uint64_t
         pax->type = type;
         memcpy(pax->buf,buf,sizeof(pax->buf));
         HASH_ADD_KEYPTR(hh,PAX,pax->buf,sizeof(pax->buf),pax);
+        komodo_paxpending(pax);
         addflag = 1;
         if ( 0 && ASSETCHAINS_SYMBOL[0] == 0 )
         {
@@ -152,7 +184,10 @@ void komodo_gateway_deposit(char *coinaddr,uint64_t value,char *symbol,uint64_t
     }
     else
     {
-        pax->marked = height;
+        pthread_mutex_lock(&komodo_mutex);
+        if ( (pax->marked= height) == 0 ) // unmarked again, it has to be back in PAX_PENDING
+            komodo_paxpending(pax);
+        pthread_mutex_unlock(&komodo_mutex);
         //printf("pax.%p MARK DEPOSIT ht.%d other.%d\n",pax,height,otherheight);
     }
 }
@@ -289,17 +324,25 @@ int32_t komodo_paxcmp(char *symbol,int32_t kmdheight,uint64_t value,uint64_t che
     return(value != checkvalue);
 }
 
+// only visits PAX_PENDING, marked entries never contribute and are dropped from it at the end
 uint64_t komodo_paxtotal()
 {
-    struct pax_transaction *pax,*pax2,*tmp,*tmp2; char symbol[KOMODO_ASSETCHAIN_MAXLEN],dest[KOMODO_ASSETCHAIN_MAXLEN],*str; int32_t i,ht; int64_t checktoshis; uint64_t seed,total = 0; struct komodo_state *basesp;
+    struct pax_transaction *pax,*pax2,**paxes; char symbol[KOMODO_ASSETCHAIN_MAXLEN],dest[KOMODO_ASSETCHAIN_MAXLEN],*str; int32_t i,n,ht; int64_t checktoshis; uint64_t seed,total = 0; struct komodo_state *basesp;
     if ( KOMODO_PASSPORT_INITDONE == 0 ) //KOMODO_PAX == 0 ||
         return(0);
     if ( komodo_isrealtime(&ht) == 0 )
         return(0);
-    else
+    pthread_mutex_lock(&komodo_mutex);
+    if ( (n= NUM_PAX_PENDING) > 0 )
+    {
+        paxes = (struct pax_transaction **)malloc(sizeof(*paxes) * n);
+        memcpy(paxes,PAX_PENDING,sizeof(*paxes) * n);
+    } else paxes = 0;
+    pthread_mutex_unlock(&komodo_mutex);
     {
-        HASH_ITER(hh,PAX,pax,tmp)
+        for (i=0; i<n; i++)
         {
+            pax = paxes[i];
             if ( pax->marked != 0 )
                 continue;
             if ( pax->type == 'A' || pax->type == 'D' || pax->type == 'X' )
@@ -346,8 +389,9 @@ uint64_t komodo_paxtotal()
         }
     }
     komodo_stateptr(symbol,dest);
-    HASH_ITER(hh,PAX,pax,tmp)
+    for (i=0; i<n; i++)
     {
+        pax = paxes[i];
         pax->ready = 0;
         if ( 0 && pax->type == 'A' )
             printf("%p pax.%s <- %s marked.%d %.8f -> %.8f validated.%d approved.%d\n",pax,pax->symbol,pax->source,pax->marked,dstr(pax->komodoshis),dstr(pax->fiatoshis),pax->validated != 0,pax->approved != 0);
@@ -394,6 +438,11 @@ uint64_t komodo_paxtotal()
             }
         }
     }
+    pthread_mutex_lock(&komodo_mutex);
+    komodo_paxpending_compact();
+    pthread_mutex_unlock(&komodo_mutex);
+    if ( paxes != 0 )
+        free(paxes);
     //printf("paxtotal %.8f\n",dstr(total));
     return(total);
 }
@@ -1072,7 +1121,7 @@ const char *komodo_opreturn(int32_t height,uint64_t value,uint8_t *opretbuf,int3
     tokomodo = (komodo_is_issuer() == 0);
     if ( opretbuf[0] == 'K' && opretlen != 40 )
     {
-        komodo_kvupdate(opretbuf,opretlen,value);
+        komodo_kvupdate(opretbuf,opretlen,value,height,txid,vout);
         return("kv");
     }
     else if ( ASSETCHAINS_SYMBOL[0] == 0 && KOMODO_PAX == 0 )
@@ -1156,8 +1205,12 @@ const char *komodo_opreturn(int32_t height,uint64_t value,uint8_t *opretbuf,int3
                 }
                 else
                 {
-                    if ( (pax= komodo_paxfind(txid,vout,'D')) != 0 )
-                        pax->marked = checktoshis;
+                    if ( (pax= komodo_paxfind(txid,vout,'D')) != 0 && (pax->marked= checktoshis) == 0 )
+                    {
+                        pthread_mutex_lock(&komodo_mutex);
+                        komodo_paxpending(pax);
+                        pthread_mutex_unlock(&komodo_mutex);
+                    }
                     if ( kmdheight > 238000 && (kmdheight > 214700 || strcmp(base,ASSETCHAINS_SYMBOL) == 0) ) //seed != 0 &&
                         printf("pax %s deposit %.8f rejected kmdheight.%d %.8f KMD check %.8f seed.%llu\n",base,dstr(fiatoshis),kmdheight,dstr(value),dstr(checktoshis),(long long)seed);
                 }
@@ -1380,6 +1433,7 @@ const char *komodo_opreturn(int32_t height,uint64_t value,uint8_t *opretbuf,int3
 }
 
 int32_t komodo_parsestatefiledata(struct komodo_state *sp,uint8_t *filedata,long *fposp,long datalen,char *symbol,char *dest);
+long komodo_staterecordlen(uint8_t *data,long datalen);
 
 void komodo_stateind_set(struct komodo_state *sp,uint32_t *inds,int32_t n,uint8_t *filedata,long datalen,char *symbol,char *dest)
 {
@@ -1585,10 +1639,375 @@ long komodo_indfile_update(FILE *indfp,uint32_t *prevpos100p,long lastfpos,long
     return(newfpos);
 }
 
+// komodostate.snap: everything replaying komodostate up to fpos produces, so a restart only replays the tail
+#define KOMODO_SNAPSHOT_MAGIC 0x31504e53 // "SNP1"
+#define KOMODO_SNAPSHOT_VERSION 4
+#define KOMODO_SNAPSHOT_WINDOW 4096
+#define KOMODO_SNAPSHOT_INTERVAL (4 << 20) // resnapshot after this many new komodostate bytes
+
+int32_t memread(void *dest,int32_t size,uint8_t *filedata,long *fposp,long datalen);
+
+// pax_transaction fields as stored in the snapshot, rwflag -1 only returns the size. buf is recomputed from the key fields
+int32_t komodo_rwsnappax(int32_t rwflag,uint8_t *data,struct pax_transaction *pax)
+{
+    int32_t len = 0;
+#define KOMODO_RWSNAPPAX(field) if ( rwflag > 0 ) memcpy(&data[len],&pax->field,sizeof(pax->field)); else if ( rwflag == 0 ) memcpy(&pax->field,&data[len],sizeof(pax->field)); len += sizeof(pax->field)
+    KOMODO_RWSNAPPAX(txid);
+    KOMODO_RWSNAPPAX(komodoshis);
+    KOMODO_RWSNAPPAX(fiatoshis);
+    KOMODO_RWSNAPPAX(validated);
+    KOMODO_RWSNAPPAX(marked);
+    KOMODO_RWSNAPPAX(height);
+    KOMODO_RWSNAPPAX(otherheight);
+    KOMODO_RWSNAPPAX(approved);
+    KOMODO_RWSNAPPAX(didstats);
+    KOMODO_RWSNAPPAX(ready);
+    KOMODO_RWSNAPPAX(vout);
+    KOMODO_RWSNAPPAX(symbol);
+    KOMODO_RWSNAPPAX(source);
+    KOMODO_RWSNAPPAX(coinaddr);
+    KOMODO_RWSNAPPAX(rmd160);
+    KOMODO_RWSNAPPAX(type);
+#undef KOMODO_RWSNAPPAX
+    if ( rwflag == 0 )
+        pax_keyset(pax->buf,pax->txid,pax->vout,pax->type);
+    return(len);
+}
+
+int32_t komodo_snapwrite(FILE *fp,uint32_t *crcp,void *data,int32_t len)
+{
+    *crcp = calc_crc32(*crcp,data,len);
+    return(fwrite(data,1,len,fp) != len);
+}
+
+uint32_t komodo_statewindow_crc(FILE *fp,long fpos)
+{
+    uint8_t buf[KOMODO_SNAPSHOT_WINDOW]; long len,savepos;
+    if ( (len= fpos) > KOMODO_SNAPSHOT_WINDOW )
+        len = KOMODO_SNAPSHOT_WINDOW;
+    savepos = ftell(fp);
+    fseek(fp,fpos - len,SEEK_SET);
+    if ( fread(buf,1,len,fp) != len )
+        len = 0;
+    fseek(fp,savepos,SEEK_SET);
+    return(calc_crc32(0,buf,len));
+}
+
+int32_t komodo_snapshot_save(struct komodo_state *sp,FILE *statefp,long fpos)
+{
+    FILE *fp; char fname[512],tmpname[512]; uint32_t magic = KOMODO_SNAPSHOT_MAGIC,version = KOMODO_SNAPSHOT_VERSION,crc = 0,windowcrc; int64_t pos64 = fpos;
+    int32_t i,n,num,kvheight,snapheight,errs = 0; struct notarized_checkpoint *np; struct pax_transaction *pax,*ptmp; uint8_t pubkeys[64][33],paxdata[sizeof(*pax)]; struct knotary_entry *nkp,*ntmp;
+    komodo_statefname(fname,ASSETCHAINS_SYMBOL,(char *)"komodostate.snap");
+    safecopy(tmpname,fname,sizeof(tmpname)-4);
+    strcat(tmpname,".tmp");
+    windowcrc = komodo_statewindow_crc(statefp,fpos);
+    kvheight = komodo_kvsync(); // kv state lives in the kvstore, the snapshot only needs it to be at least this complete
+    portable_mutex_lock(&komodo_mutex);
+    snapheight = sp->SNAPSHOT_HEIGHT; // highest event the snapshot covers
+    if ( sp->Komodo_lastevent != 0 && sp->Komodo_lastevent->height > snapheight )
+        snapheight = sp->Komodo_lastevent->height;
+    portable_mutex_unlock(&komodo_mutex);
+    if ( (fp= fopen(tmpname,"wb")) == 0 )
+        return(-1);
+    errs += komodo_snapwrite(fp,&crc,&magic,sizeof(magic));
+    errs += komodo_snapwrite(fp,&crc,&version,sizeof(version));
+    errs += komodo_snapwrite(fp,&crc,ASSETCHAINS_SYMBOL,sizeof(ASSETCHAINS_SYMBOL));
+    errs += komodo_snapwrite(fp,&crc,&KOMODO_EXTERNAL_NOTARIES,sizeof(KOMODO_EXTERNAL_NOTARIES));
+    errs += komodo_snapwrite(fp,&crc,&KOMODO_PAX,sizeof(KOMODO_PAX));
+    errs += komodo_snapwrite(fp,&crc,&pos64,sizeof(pos64));
+    errs += komodo_snapwrite(fp,&crc,&windowcrc,sizeof(windowcrc));
+    errs += komodo_snapwrite(fp,&crc,&kvheight,sizeof(kvheight));
+    errs += komodo_snapwrite(fp,&crc,&snapheight,sizeof(snapheight));
+    portable_mutex_lock(&komodo_mutex);
+    errs += komodo_snapwrite(fp,&crc,&sp->NOTARIZED_HASH,sizeof(sp->NOTARIZED_HASH));
+    errs += komodo_snapwrite(fp,&crc,&sp->NOTARIZED_DESTTXID,sizeof(sp->NOTARIZED_DESTTXID));
+    errs += komodo_snapwrite(fp,&crc,&sp->MoM,sizeof(sp->MoM));
+    errs += komodo_snapwrite(fp,&crc,&sp->SAVEDHEIGHT,sizeof(sp->SAVEDHEIGHT));
+    errs += komodo_snapwrite(fp,&crc,&sp->CURRENT_HEIGHT,sizeof(sp->CURRENT_HEIGHT));
+    errs += komodo_snapwrite(fp,&crc,&sp->NOTARIZED_HEIGHT,sizeof(sp->NOTARIZED_HEIGHT));
+    errs += komodo_snapwrite(fp,&crc,&sp->MoMdepth,sizeof(sp->MoMdepth));
+    errs += komodo_snapwrite(fp,&crc,&sp->SAVEDTIMESTAMP,sizeof(sp->SAVEDTIMESTAMP));
+    errs += komodo_snapwrite(fp,&crc,&sp->deposited,sizeof(sp->deposited));
+    errs += komodo_snapwrite(fp,&crc,&sp->issued,sizeof(sp->issued));
+    errs += komodo_snapwrite(fp,&crc,&sp->withdrawn,sizeof(sp->withdrawn));
+    errs += komodo_snapwrite(fp,&crc,&sp->approved,sizeof(sp->approved));
+    errs += komodo_snapwrite(fp,&crc,&sp->redeemed,sizeof(sp->redeemed));
+    errs += komodo_snapwrite(fp,&crc,&sp->shorted,sizeof(sp->shorted));
+    num = sp->NUM_NPOINTS;
+    errs += komodo_snapwrite(fp,&crc,&num,sizeof(num));
+    for (i=0; i<num; i++)
+    {
+        np = komodo_npptr(sp,i);
+        errs += komodo_snapwrite(fp,&crc,&np->nHeight,sizeof(np->nHeight));
+        errs += komodo_snapwrite(fp,&crc,&np->notarized_height,sizeof(np->notarized_height));
+        errs += komodo_snapwrite(fp,&crc,&np->MoMdepth,sizeof(np->MoMdepth));
+        errs += komodo_snapwrite(fp,&crc,&np->notarized_hash,sizeof(np->notarized_hash));
+        errs += komodo_snapwrite(fp,&crc,&np->notarized_desttxid,sizeof(np->notarized_desttxid));
+        errs += komodo_snapwrite(fp,&crc,&np->MoM,sizeof(np->MoM));
+    }
+    num = (Pubkeys != 0) ? (KOMODO_MAXBLOCKS / KOMODO_ELECTION_GAP) : 0;
+    errs += komodo_snapwrite(fp,&crc,&num,sizeof(num));
+    for (i=0; i<num; i++)
+    {
+        n = Pubkeys[i].numnotaries;
+        memset(pubkeys,0,sizeof(pubkeys));
+        HASH_ITER(hh,Pubkeys[i].Notaries,nkp,ntmp)
+        {
+            if ( nkp->notaryid < 64 )
+                memcpy(pubkeys[nkp->notaryid],nkp->pubkey,33);
+        }
+        errs += komodo_snapwrite(fp,&crc,&Pubkeys[i].height,sizeof(Pubkeys[i].height));
+        errs += komodo_snapwrite(fp,&crc,&n,sizeof(n));
+        errs += komodo_snapwrite(fp,&crc,pubkeys,33 * n);
+    }
+    num = HASH_COUNT(PAX);
+    errs += komodo_snapwrite(fp,&crc,&num,sizeof(num));
+    HASH_ITER(hh,PAX,pax,ptmp)
+    {
+        n = komodo_rwsnappax(1,paxdata,pax);
+        errs += komodo_snapwrite(fp,&crc,paxdata,n);
+    }
+    errs += komodo_snapwrite(fp,&crc,&NUM_PRICES,sizeof(NUM_PRICES));
+    errs += komodo_snapwrite(fp,&crc,PVALS,(int32_t)(sizeof(*PVALS) * 36 * NUM_PRICES));
+    portable_mutex_unlock(&komodo_mutex);
+    if ( fwrite(&crc,1,sizeof(crc),fp) != sizeof(crc) )
+        errs++;
+    fclose(fp);
+    if ( errs != 0 || rename(tmpname,fname) != 0 )
+    {
+        fprintf(stderr,"komodo_snapshot_save errs.%d %s\n",errs,fname);
+        remove(tmpname);
+        return(-1);
+    }
+    return(0);
+}
+
+// the komodostate offset the snapshot was taken at, always a record boundary. -1 if there is no snapshot of statefp
+long komodo_snapshot_pos(FILE *statefp,long statelen)
+{
+    char fname[512],symbol[sizeof(ASSETCHAINS_SYMBOL)]; uint8_t *filedata; long fpos = 0,datalen; int64_t pos64 = -1; uint32_t magic,version,crc,windowcrc; int32_t extnotaries,pax;
+    komodo_statefname(fname,ASSETCHAINS_SYMBOL,(char *)"komodostate.snap");
+    if ( (filedata= OS_fileptr(&datalen,fname)) == 0 )
+        return(-1);
+    if ( datalen >= sizeof(crc) && (memcpy(&crc,&filedata[datalen - sizeof(crc)],sizeof(crc)), crc == calc_crc32(0,filedata,datalen - sizeof(crc))) )
+    {
+        datalen -= sizeof(crc);
+        memread(&magic,sizeof(magic),filedata,&fpos,datalen);
+        memread(&version,sizeof(version),filedata,&fpos,datalen);
+        memread(symbol,sizeof(symbol),filedata,&fpos,datalen);
+        memread(&extnotaries,sizeof(extnotaries),filedata,&fpos,datalen);
+        memread(&pax,sizeof(pax),filedata,&fpos,datalen);
+        memread(&pos64,sizeof(pos64),filedata,&fpos,datalen);
+        if ( memread(&windowcrc,sizeof(windowcrc),filedata,&fpos,datalen) != sizeof(windowcrc) || magic != KOMODO_SNAPSHOT_MAGIC || version != KOMODO_SNAPSHOT_VERSION || strcmp(symbol,ASSETCHAINS_SYMBOL) != 0 || pos64 < 0 || pos64 > statelen || windowcrc != komodo_statewindow_crc(statefp,(long)pos64) )
+            pos64 = -1;
+    }
+    free(filedata);
+    return((long)pos64);
+}
+
+// walks every section of the snapshot without touching any state, returns 0 if all of them are complete
+int32_t komodo_snapshot_check(uint8_t *filedata,long fpos,long datalen)
+{
+    int32_t i,n,num; int64_t len;
+    fpos += 3*sizeof(uint256) + 4*sizeof(int32_t) + sizeof(uint32_t) + 6*sizeof(uint64_t);
+    if ( fpos > datalen || memread(&num,sizeof(num),filedata,&fpos,datalen) != sizeof(num) || num < 0 || (len= (int64_t)num * (3*sizeof(int32_t) + 3*sizeof(uint256))) > datalen - fpos )
+        return(-1);
+    fpos += (long)len;
+    if ( memread(&num,sizeof(num),filedata,&fpos,datalen) != sizeof(num) || num < 0 || num > KOMODO_MAXBLOCKS / KOMODO_ELECTION_GAP )
+        return(-2);
+    for (i=0; i<num; i++)
+    {
+        fpos += sizeof(int32_t);
+        if ( fpos > datalen || memread(&n,sizeof(n),filedata,&fpos,datalen) != sizeof(n) || n < 0 || n > 64 || 33*n > datalen - fpos )
+            return(-3);
+        fpos += 33 * n;
+    }
+    if ( memread(&num,sizeof(num),filedata,&fpos,datalen) != sizeof(num) || num < 0 || (len= (int64_t)num * komodo_rwsnappax(-1,0,0)) > datalen - fpos )
+        return(-4);
+    fpos += (long)len;
+    if ( memread(&num,sizeof(num),filedata,&fpos,datalen) != sizeof(num) || num < 0 || (len= (int64_t)num * 36 * sizeof(uint32_t)) != datalen - fpos )
+        return(-5);
+    return(0);
+}
+
+// the restored eras replace whatever tables komodo_init already set up, consecutive eras share a table
+void komodo_snapshot_freenotaries(int32_t num)
+{
+    struct knotary_entry *table,*nkp,*ntmp,*prev = 0; int32_t i;
+    for (i=0; i<num; i++)
+    {
+        table = Pubkeys[i].Notaries;
+        Pubkeys[i].Notaries = 0;
+        if ( table != 0 && table != prev && (num >= KOMODO_MAXBLOCKS / KOMODO_ELECTION_GAP || table != Pubkeys[num].Notaries) )
+        {
+            prev = table;
+            HASH_ITER(hh,table,nkp,ntmp)
+            {
+                HASH_DEL(table,nkp);
+                free(nkp);
+            }
+        } else prev = table;
+    }
+}
+
+// returns the komodostate offset the snapshot covers, or -1 if there is no usable snapshot
+long komodo_snapshot_load(struct komodo_state *sp,FILE *statefp,long statelen)
+{
+    char fname[512],symbol[sizeof(ASSETCHAINS_SYMBOL)]; uint8_t *filedata,pubkeys[64][33],prevpubkeys[64][33]; long fpos = 0,datalen; int64_t pos64; uint32_t magic,version,crc,windowcrc;
+    int32_t i,j,n,num,height,notarized_height,MoMdepth,extnotaries,pax,kvheight,snapheight,errs; uint256 hash,desttxid,MoM; struct pax_transaction *paxp,*tmpp; struct knotary_entry *nkp;
+    komodo_statefname(fname,ASSETCHAINS_SYMBOL,(char *)"komodostate.snap");
+    if ( (filedata= OS_fileptr(&datalen,fname)) == 0 )
+        return(-1);
+    if ( datalen < sizeof(crc) || (memcpy(&crc,&filedata[datalen - sizeof(crc)],sizeof(crc)), crc != calc_crc32(0,filedata,datalen - sizeof(crc))) )
+    {
+        fprintf(stderr,"%s checksum mismatch, ignoring snapshot\n",fname);
+        free(filedata);
+        return(-1);
+    }
+    datalen -= sizeof(crc);
+    memread(&magic,sizeof(magic),filedata,&fpos,datalen);
+    memread(&version,sizeof(version),filedata,&fpos,datalen);
+    memread(symbol,sizeof(symbol),filedata,&fpos,datalen);
+    memread(&extnotaries,sizeof(extnotaries),filedata,&fpos,datalen);
+    memread(&pax,sizeof(pax),filedata,&fpos,datalen);
+    memread(&pos64,sizeof(pos64),filedata,&fpos,datalen);
+    memread(&windowcrc,sizeof(windowcrc),filedata,&fpos,datalen);
+    memread(&kvheight,sizeof(kvheight),filedata,&fpos,datalen);
+    if ( memread(&snapheight,sizeof(snapheight),filedata,&fpos,datalen) != sizeof(snapheight) || magic != KOMODO_SNAPSHOT_MAGIC || version != KOMODO_SNAPSHOT_VERSION || strcmp(symbol,ASSETCHAINS_SYMBOL) != 0 || extnotaries != KOMODO_EXTERNAL_NOTARIES || pax != KOMODO_PAX || pos64 > statelen || windowcrc != komodo_statewindow_crc(statefp,(long)pos64) || kvheight > komodo_kvsync() )
+    {
+        fprintf(stderr,"%s doesnt match komodostate, ignoring snapshot\n",fname);
+        free(filedata);
+        return(-1);
+    }
+    if ( (errs= komodo_snapshot_check(filedata,fpos,datalen)) != 0 ) // checksum was fine so the writer is at fault, the full replay rebuilds it
+    {
+        fprintf(stderr,"%s malformed section.%d, ignoring snapshot\n",fname,-errs);
+        free(filedata);
+        return(-1);
+    }
+    // from here on every memread is known to succeed
+    memread(&sp->NOTARIZED_HASH,sizeof(sp->NOTARIZED_HASH),filedata,&fpos,datalen);
+    memread(&sp->NOTARIZED_DESTTXID,sizeof(sp->NOTARIZED_DESTTXID),filedata,&fpos,datalen);
+    memread(&sp->MoM,sizeof(sp->MoM),filedata,&fpos,datalen);
+    memread(&sp->SAVEDHEIGHT,sizeof(sp->SAVEDHEIGHT),filedata,&fpos,datalen);
+    memread(&sp->CURRENT_HEIGHT,sizeof(sp->CURRENT_HEIGHT),filedata,&fpos,datalen);
+    memread(&sp->NOTARIZED_HEIGHT,sizeof(sp->NOTARIZED_HEIGHT),filedata,&fpos,datalen);
+    memread(&sp->MoMdepth,sizeof(sp->MoMdepth),filedata,&fpos,datalen);
+    memread(&sp->SAVEDTIMESTAMP,sizeof(sp->SAVEDTIMESTAMP),filedata,&fpos,datalen);
+    memread(&sp->deposited,sizeof(sp->deposited),filedata,&fpos,datalen);
+    memread(&sp->issued,sizeof(sp->issued),filedata,&fpos,datalen);
+    memread(&sp->withdrawn,sizeof(sp->withdrawn),filedata,&fpos,datalen);
+    memread(&sp->approved,sizeof(sp->approved),filedata,&fpos,datalen);
+    memread(&sp->redeemed,sizeof(sp->redeemed),filedata,&fpos,datalen);
+    memread(&sp->shorted,sizeof(sp->shorted),filedata,&fpos,datalen);
+    {
+        // komodo_notarized_update overwrites the NOTARIZED_* fields, so keep what the snapshot says
+        uint256 savehash = sp->NOTARIZED_HASH,savetxid = sp->NOTARIZED_DESTTXID,saveMoM = sp->MoM; int32_t saveht = sp->NOTARIZED_HEIGHT,savedepth = sp->MoMdepth;
+        memread(&num,sizeof(num),filedata,&fpos,datalen);
+        for (i=0; i<num; i++)
+        {
+            memread(&height,sizeof(height),filedata,&fpos,datalen);
+            memread(&notarized_height,sizeof(notarized_height),filedata,&fpos,datalen);
+            memread(&MoMdepth,sizeof(MoMdepth),filedata,&fpos,datalen);
+            memread(&hash,sizeof(hash),filedata,&fpos,datalen);
+            memread(&desttxid,sizeof(desttxid),filedata,&fpos,datalen);
+            memread(&MoM,sizeof(MoM),filedata,&fpos,datalen);
+            komodo_notarized_update(sp,height,notarized_height,hash,desttxid,MoM,MoMdepth);
+        }
+        sp->NOTARIZED_HASH = savehash, sp->NOTARIZED_DESTTXID = savetxid, sp->MoM = saveMoM;
+        sp->NOTARIZED_HEIGHT = saveht, sp->MoMdepth = savedepth;
+    }
+    memread(&num,sizeof(num),filedata,&fpos,datalen);
+    if ( num > 0 && Pubkeys == 0 )
+    {
+        Pubkeys = (struct knotaries_entry *)calloc(1 + (KOMODO_MAXBLOCKS / KOMODO_ELECTION_GAP),sizeof(*Pubkeys));
+        Pubkeys_snapshot = (struct knotaries_snapshot **)calloc(1 + (KOMODO_MAXBLOCKS / KOMODO_ELECTION_GAP),sizeof(*Pubkeys_snapshot));
+    }
+    portable_mutex_lock(&komodo_mutex);
+    if ( num > 0 )
+        komodo_snapshot_freenotaries(num);
+    for (i=0; i<num; i++)
+    {
+        memread(&height,sizeof(height),filedata,&fpos,datalen);
+        memread(&n,sizeof(n),filedata,&fpos,datalen);
+        memread(pubkeys,33 * n,filedata,&fpos,datalen);
+        if ( i > 0 && n == Pubkeys[i-1].numnotaries && n > 0 && memcmp(pubkeys,prevpubkeys,33*n) == 0 )
+        {
+            Pubkeys[i].Notaries = Pubkeys[i-1].Notaries; // same election as the previous era, share its table
+            komodo_notaryset_publish(i,komodo_notaryset(i-1));
+        }
+        else
+        {
+            komodo_notaryset_publish(i,komodo_notaryset_create(pubkeys,n));
+            Pubkeys[i].Notaries = 0;
+            for (j=0; j<n; j++)
+            {
+                nkp = (struct knotary_entry *)calloc(1,sizeof(*nkp));
+                memcpy(nkp->pubkey,pubkeys[j],33);
+                nkp->notaryid = j;
+                HASH_ADD_KEYPTR(hh,Pubkeys[i].Notaries,nkp->pubkey,33,nkp);
+            }
+        }
+        Pubkeys[i].height = height;
+        Pubkeys[i].numnotaries = n;
+        memcpy(prevpubkeys,pubkeys,33*n);
+    }
+    __atomic_add_fetch(&KOMODO_NOTARYSET_GEN,1,__ATOMIC_RELEASE);
+    memread(&num,sizeof(num),filedata,&fpos,datalen);
+    for (i=0; i<num; i++)
+    {
+        paxp = (struct pax_transaction *)calloc(1,sizeof(*paxp));
+        fpos += komodo_rwsnappax(0,&filedata[fpos],paxp);
+        HASH_FIND(hh,PAX,paxp->buf,sizeof(paxp->buf),tmpp);
+        if ( tmpp == 0 )
+        {
+            HASH_ADD_KEYPTR(hh,PAX,paxp->buf,sizeof(paxp->buf),paxp);
+            if ( paxp->marked == 0 )
+                komodo_paxpending(paxp);
+        } else free(paxp);
+    }
+    memread(&num,sizeof(num),filedata,&fpos,datalen);
+    if ( num > 0 )
+    {
+        PVALS = (uint32_t *)realloc(PVALS,sizeof(*PVALS) * 36 * num);
+        memread(PVALS,(int32_t)(sizeof(*PVALS) * 36 * num),filedata,&fpos,datalen);
+        NUM_PRICES = num;
+        komodo_pvals_compact();
+    }
+    sp->SNAPSHOT_POS = (long)pos64;
+    sp->SNAPSHOT_HEIGHT = snapheight;
+    portable_mutex_unlock(&komodo_mutex);
+    free(filedata);
+    return((long)pos64);
+}
+
 int32_t komodo_faststateinit(struct komodo_state *sp,char *fname,char *symbol,char *dest)
 {
-    FILE *indfp; char indfname[1024]; uint8_t *filedata; long validated=-1,datalen,fpos,lastfpos; uint32_t tmp,prevpos100,indcounter,starttime; int32_t func,finished = 0;
+    FILE *indfp,*fp; char indfname[1024]; uint8_t *filedata; long validated=-1,datalen,fpos,lastfpos,taillen; uint32_t tmp,prevpos100,indcounter,starttime; int32_t func,finished = 0;
     starttime = (uint32_t)time(NULL);
+    if ( GetArg("-genind",0) == 0 && (fp= fopen(fname,"rb")) != 0 )
+    {
+        fseek(fp,0,SEEK_END);
+        datalen = ftell(fp);
+        if ( (fpos= komodo_snapshot_load(sp,fp,datalen)) >= 0 )
+        {
+            taillen = 0;
+            if ( datalen > fpos && (filedata= (uint8_t *)malloc(datalen - fpos)) != 0 )
+            {
+                fseek(fp,fpos,SEEK_SET);
+                taillen = (long)fread(filedata,1,datalen - fpos,fp);
+                for (lastfpos=0; komodo_parsestatefiledata(sp,filedata,&lastfpos,taillen,symbol,dest) >= 0; )
+                    ;
+                free(filedata);
+            }
+            if ( taillen > 0 )
+                komodo_snapshot_save(sp,fp,fpos + taillen);
+            fclose(fp);
+            fprintf(stderr,"%s restored from snapshot at %ldKB, replayed %ldKB tail in %d seconds\n",fname,fpos/1024,taillen/1024,(int32_t)(time(NULL)-starttime));
+            return(1);
+        }
+        fclose(fp);
+    }
     safecopy(indfname,fname,sizeof(indfname)-4);
     strcat(indfname,".ind");
     if ( (filedata= OS_fileptr(&datalen,fname)) != 0 )
@@ -1612,7 +2031,12 @@ int32_t komodo_faststateinit(struct komodo_state *sp,char *fname,char *symbol,ch
                 else printf("%s validated fpos.%ld\n",indfname,fpos);
             }
             finished = 1;
-            fprintf(stderr,"took %d seconds to process %s %ldKB\n",(int32_t)(time(NULL)-starttime),fname,datalen/1024);
+            if ( (fp= fopen(fname,"rb")) != 0 )
+            {
+                komodo_snapshot_save(sp,fp,datalen);
+                fclose(fp);
+            }
+            fprintf(stderr,"took %d seconds to process %s %ldKB, events.%d in %dKB arena\n",(int32_t)(time(NULL)-starttime),fname,datalen/1024,sp->Komodo_numevents,sp->Komodo_numchunks * (KOMODO_EVENTS_CHUNKSIZE >> 10));
         }
         else if ( validated > 0 )
         {
@@ -1649,11 +2073,158 @@ int32_t komodo_faststateinit(struct komodo_state *sp,char *fname,char *symbol,ch
     return(-1);
 }
 
+#define KOMODO_TAIL_MAXREAD (16 << 20)
+
+struct komodo_tail *komodo_tail_open(char *fname,long pos)
+{
+    struct komodo_tail *tp = (struct komodo_tail *)calloc(1,sizeof(*tp));
+    safecopy(tp->fname,fname,sizeof(tp->fname));
+    tp->pos = pos;
+    return(tp);
+}
+
+void komodo_tail_close(struct komodo_tail *tp)
+{
+    if ( tp->fp != 0 )
+        fclose(tp->fp);
+    if ( tp->buf != 0 )
+        free(tp->buf);
+    free(tp);
+}
+
+// appends whatever another daemon wrote since the last call to the buffered tail, one fstat when nothing changed.
+// returns the number of unconsumed bytes at *datap
+long komodo_tail_read(struct komodo_tail *tp,uint8_t **datap)
+{
+    struct stat st; long want,n;
+    *datap = tp->buf;
+    if ( tp->fp == 0 )
+    {
+        if ( (tp->fp= fopen(tp->fname,"rb")) == 0 )
+            return(tp->len);
+        setvbuf(tp->fp,0,_IONBF,0); // reads are large already, and a stdio buffer would keep serving bytes the writer cut off
+    }
+    if ( fstat(fileno(tp->fp),&st) != 0 || st.st_nlink == 0 ) // writer replaced the file, reopen at the same offset next time
+    {
+        fclose(tp->fp);
+        tp->fp = 0;
+        return(tp->len);
+    }
+    if ( (long)st.st_size < tp->pos ) // the writer cut off a torn record on restart, what is buffered is at most that partial record
+    {
+        tp->pos -= tp->len;
+        tp->len = 0;
+        if ( (long)st.st_size < tp->pos )
+        {
+            fprintf(stderr,"%s shrank to %ld below the last complete record at %ld\n",tp->fname,(long)st.st_size,tp->pos);
+            return(0);
+        }
+    }
+    if ( (want= (long)st.st_size - tp->pos) <= 0 )
+        return(tp->len);
+    if ( want > KOMODO_TAIL_MAXREAD )
+        want = KOMODO_TAIL_MAXREAD;
+    if ( tp->len + want > tp->size )
+    {
+        tp->size = tp->len + want;
+        tp->buf = (uint8_t *)realloc(tp->buf,tp->size);
+    }
+    if ( fseek(tp->fp,tp->pos,SEEK_SET) == 0 && (n= (long)fread(&tp->buf[tp->len],1,want,tp->fp)) > 0 )
+    {
+        tp->len += n;
+        tp->pos += n;
+    }
+    *datap = tp->buf;
+    return(tp->len);
+}
+
+void komodo_tail_consume(struct komodo_tail *tp,long n)
+{
+    if ( n >= tp->len )
+        tp->len = 0;
+    else if ( n > 0 )
+    {
+        memmove(tp->buf,&tp->buf[n],tp->len - n);
+        tp->len -= n;
+    }
+}
+
+#define KOMODO_RTFILE_INTERVAL 20 // daemons without the segment only read the realtime file and treat it as stale after 60 seconds
+
+// the realtime status of all chains on this host, mapped once; 0 if shared memory is unavailable and the realtime files are used instead
+struct komodo_rtsegment *komodo_rtsegment()
+{
+    static struct komodo_rtsegment *RTSEG; static int32_t didinit;
+#ifndef _WIN32
+    char fname[512],name[64]; struct stat st; void *ptr; int fd;
+    if ( didinit == 0 )
+    {
+        didinit = 1;
+        komodo_statefname(fname,(char *)"",(char *)"realtime");
+        sprintf(name,"/komodo_rt_%08x",calc_crc32(0,(uint8_t *)fname,strlen(fname)));
+        if ( (fd= shm_open(name,O_RDWR | O_CREAT,0644)) >= 0 )
+        {
+            if ( fstat(fd,&st) == 0 && (st.st_size >= (off_t)sizeof(*RTSEG) || ftruncate(fd,sizeof(*RTSEG)) == 0) )
+            {
+                if ( (ptr= mmap(0,sizeof(*RTSEG),PROT_READ | PROT_WRITE,MAP_SHARED,fd,0)) != MAP_FAILED )
+                    RTSEG = (struct komodo_rtsegment *)ptr;
+            }
+            close(fd);
+        }
+        if ( RTSEG == 0 )
+            fprintf(stderr,"[%s] cant map realtime segment %s, using realtime files\n",ASSETCHAINS_SYMBOL,name);
+    }
+#endif
+    return(RTSEG);
+}
+
+int32_t komodo_rtslot_write(int32_t baseid,uint32_t *buf)
+{
+    struct komodo_rtsegment *seg; struct komodo_rtslot *slot; uint32_t seq;
+    if ( (seg= komodo_rtsegment()) == 0 )
+        return(-1);
+    slot = &seg->slots[baseid];
+    seq = __atomic_load_n(&slot->seq,__ATOMIC_RELAXED) | 1; // odd even if a previous writer died midway
+    __atomic_store_n(&slot->seq,seq,__ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    __atomic_store_n(&slot->height,buf[0],__ATOMIC_RELAXED);
+    __atomic_store_n(&slot->longestchain,buf[1],__ATOMIC_RELAXED);
+    __atomic_store_n(&slot->timestamp,buf[2],__ATOMIC_RELAXED);
+    __atomic_store_n(&slot->seq,seq + 1,__ATOMIC_RELEASE);
+    return(0);
+}
+
+// coherent copy of another chain's slot without any syscall, -1 if it never wrote one or kept it busy
+int32_t komodo_rtslot_read(int32_t baseid,uint32_t *buf)
+{
+    struct komodo_rtsegment *seg; struct komodo_rtslot *slot; uint32_t seq,tmp[3]; int32_t i;
+    if ( (seg= komodo_rtsegment()) == 0 )
+        return(-1);
+    slot = &seg->slots[baseid];
+    for (i=0; i<1000; i++)
+    {
+        if ( (seq= __atomic_load_n(&slot->seq,__ATOMIC_ACQUIRE)) == 0 )
+            return(-1);
+        if ( (seq & 1) != 0 )
+            continue;
+        tmp[0] = __atomic_load_n(&slot->height,__ATOMIC_RELAXED);
+        tmp[1] = __atomic_load_n(&slot->longestchain,__ATOMIC_RELAXED);
+        tmp[2] = __atomic_load_n(&slot->timestamp,__ATOMIC_RELAXED);
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if ( __atomic_load_n(&slot->seq,__ATOMIC_RELAXED) == seq )
+        {
+            memcpy(buf,tmp,sizeof(tmp));
+            return(0);
+        }
+    }
+    return(-1);
+}
+
 void komodo_passport_iteration()
 {
-    static long lastpos[34]; static char userpass[33][1024]; static uint32_t lasttime,callcounter;
+    static long lastpos[34]; static struct komodo_tail *tails[34]; static FILE *RTfps[34]; static char userpass[33][1024]; static uint32_t lasttime,callcounter,lastRTfile[3];
     int32_t maxseconds = 10;
-    FILE *fp; uint8_t *filedata; long fpos,datalen,lastfpos; int32_t baseid,limit,n,ht,isrealtime,expired,refid,blocks,longest; struct komodo_state *sp,*refsp; char *retstr,fname[512],*base,symbol[KOMODO_ASSETCHAIN_MAXLEN],dest[KOMODO_ASSETCHAIN_MAXLEN]; uint32_t buf[3],starttime; cJSON *infoobj,*result; uint64_t RTmask = 0;
+    FILE *fp; uint8_t *filedata; long fpos,datalen,lastfpos; int32_t baseid,limit,n,ht,isrealtime,expired,refid,blocks,longest; struct komodo_state *sp,*refsp; char *retstr,fname[512],*base,symbol[KOMODO_ASSETCHAIN_MAXLEN],dest[KOMODO_ASSETCHAIN_MAXLEN]; uint32_t buf[3],filebuf[3],starttime; cJSON *infoobj,*result; uint64_t RTmask = 0;
     expired = 0;
     while ( KOMODO_INITDONE == 0 )
     {
@@ -1702,86 +2273,100 @@ void komodo_passport_iteration()
                 komodo_statefname(fname,baseid<32?base:(char *)"",(char *)"komodostate");
                 komodo_nameset(symbol,dest,base);
                 sp = komodo_stateptrget(symbol);
-                n = 0;
-                if ( lastpos[baseid] == 0 && (filedata= OS_fileptr(&datalen,fname)) != 0 )
+                if ( sp != 0 && tails[baseid] == 0 )
                 {
-                    fpos = 0;
-                    fprintf(stderr,"%s processing %s %ldKB\n",ASSETCHAINS_SYMBOL,fname,datalen/1024);
-                    while ( komodo_parsestatefiledata(sp,filedata,&fpos,datalen,symbol,dest) >= 0 )
-                        lastfpos = fpos;
-                    fprintf(stderr,"%s took %d seconds to process %s %ldKB\n",ASSETCHAINS_SYMBOL,(int32_t)(time(NULL)-starttime),fname,datalen/1024);
-                    lastpos[baseid] = lastfpos;
-                    free(filedata), filedata = 0;
-                    datalen = 0;
+                    if ( lastpos[baseid] == 0 )
+                        fprintf(stderr,"%s processing %s\n",ASSETCHAINS_SYMBOL,fname);
+                    tails[baseid] = komodo_tail_open(fname,lastpos[baseid]);
                 }
-                else if ( (fp= fopen(fname,"rb")) != 0 && sp != 0 )
+                if ( sp != 0 )
                 {
-                    fseek(fp,0,SEEK_END);
-                    //fprintf(stderr,"couldnt OS_fileptr(%s), freading %ldKB\n",fname,ftell(fp)/1024);
-                    if ( ftell(fp) > lastpos[baseid] )
+                    // only complete records are parsed, a partially appended one stays buffered until its writer finishes it
+                    while ( (datalen= komodo_tail_read(tails[baseid],&filedata)) > 0 )
                     {
-                        if ( ASSETCHAINS_SYMBOL[0] != 0 )
-                            printf("%s passport refid.%d %s fname.(%s) base.%s %ld %ld\n",ASSETCHAINS_SYMBOL,refid,symbol,fname,base,ftell(fp),lastpos[baseid]);
-                        fseek(fp,lastpos[baseid],SEEK_SET);
-                        while ( komodo_parsestatefile(sp,fp,symbol,dest) >= 0 && n < limit )
+                        for (fpos=0; (n= (int32_t)komodo_staterecordlen(&filedata[fpos],datalen - fpos)) != 0; fpos=lastfpos)
                         {
-                            if ( n == limit-1 )
+                            if ( n < 0 ) // skip the bad byte instead of stalling this tail forever
                             {
-                                if ( time(NULL) < starttime+maxseconds )
-                                    n = 0;
-                                else
-                                {
-                                    //printf("expire passport loop %s -> %s at %ld\n",ASSETCHAINS_SYMBOL,base,lastpos[baseid]);
-                                    expired++;
-                                }
+                                fprintf(stderr,"[%s] %s illegal func.(%d %c) at %ld in %s, skipping it\n",ASSETCHAINS_SYMBOL,symbol,filedata[fpos],filedata[fpos],lastpos[baseid] + fpos,fname);
+                                lastfpos = fpos + 1;
+                                continue;
                             }
-                            n++;
+                            lastfpos = fpos + n;
+                            komodo_parsestatefiledata(sp,filedata,&fpos,lastfpos,symbol,dest);
+                        }
+                        komodo_tail_consume(tails[baseid],fpos);
+                        lastpos[baseid] += fpos;
+                        if ( fpos == 0 )
+                            break;
+                        if ( time(NULL) >= starttime+maxseconds )
+                        {
+                            //printf("expire passport loop %s -> %s at %ld\n",ASSETCHAINS_SYMBOL,base,lastpos[baseid]);
+                            expired++;
+                            break;
                         }
-                        lastpos[baseid] = ftell(fp);
-                        if ( 0 && lastpos[baseid] == 0 && strcmp(symbol,"KMD") == 0 )
-                            printf("from.(%s) lastpos[%s] %ld isrt.%d\n",ASSETCHAINS_SYMBOL,CURRENCIES[baseid],lastpos[baseid],komodo_isrealtime(&ht));
-                    } //else fprintf(stderr,"%s.%ld ",CURRENCIES[baseid],ftell(fp));
-                    fclose(fp);
+                    }
                 } else fprintf(stderr,"load error.(%s) %p\n",fname,sp);
-                komodo_statefname(fname,baseid<32?base:(char *)"",(char *)"realtime");
-                if ( (fp= fopen(fname,"rb")) != 0 )
+                // a fresh slot is enough, otherwise that chain may be run by a daemon that only writes the file
+                if ( (n= komodo_rtslot_read(baseid,buf)) != 0 || buf[2] <= time(NULL)-60 )
                 {
-                    if ( fread(buf,1,sizeof(buf),fp) == sizeof(buf) )
+                    if ( RTfps[baseid] == 0 )
                     {
-                        sp->CURRENT_HEIGHT = buf[0];
-                        if ( buf[0] != 0 && buf[0] >= buf[1] && buf[2] > time(NULL)-60 )
-                        {
-                            isrealtime = 1;
-                            RTmask |= (1LL << baseid);
-                            memcpy(refsp->RTbufs[baseid+1],buf,sizeof(refsp->RTbufs[baseid+1]));
-                        }
-                        else if ( KOMODO_PAX != 0 && (time(NULL)-buf[2]) > 60 && ASSETCHAINS_SYMBOL[0] != 0 )
-                            fprintf(stderr,"[%s]: %s not RT %u %u %d\n",ASSETCHAINS_SYMBOL,base,buf[0],buf[1],(int32_t)(time(NULL)-buf[2]));
-                    } //else fprintf(stderr,"%s size error RT\n",base);
-                    fclose(fp);
-                } //else fprintf(stderr,"%s open error RT\n",base);
+                        komodo_statefname(fname,baseid<32?base:(char *)"",(char *)"realtime");
+                        RTfps[baseid] = fopen(fname,"rb");
+                    }
+                    if ( (fp= RTfps[baseid]) != 0 && fseek(fp,0,SEEK_SET) == 0 && fread(filebuf,1,sizeof(filebuf),fp) == sizeof(filebuf) && (n != 0 || filebuf[2] > buf[2]) )
+                    {
+                        memcpy(buf,filebuf,sizeof(buf));
+                        n = 0;
+                    }
+                    //else fprintf(stderr,"%s open/size error RT\n",base);
+                }
+                if ( n == 0 )
+                {
+                    sp->CURRENT_HEIGHT = buf[0];
+                    if ( buf[0] != 0 && buf[0] >= buf[1] && buf[2] > time(NULL)-60 )
+                    {
+                        isrealtime = 1;
+                        RTmask |= (1LL << baseid);
+                        memcpy(refsp->RTbufs[baseid+1],buf,sizeof(refsp->RTbufs[baseid+1]));
+                    }
+                    else if ( KOMODO_PAX != 0 && (time(NULL)-buf[2]) > 60 && ASSETCHAINS_SYMBOL[0] != 0 )
+                        fprintf(stderr,"[%s]: %s not RT %u %u %d\n",ASSETCHAINS_SYMBOL,base,buf[0],buf[1],(int32_t)(time(NULL)-buf[2]));
+                }
             }
         }
         else
         {
             refsp->RTmask &= ~(1LL << baseid);
-            komodo_statefname(fname,baseid<32?base:(char *)"",(char *)"realtime");
-            if ( (fp= fopen(fname,"wb")) != 0 )
+            buf[0] = (uint32_t)chainActive.Tip()->nHeight;
+            buf[1] = (uint32_t)komodo_longestchain();
+            buf[2] = 0;
+            if ( buf[0] != 0 && buf[0] == buf[1] )
+            {
+                buf[2] = (uint32_t)time(NULL);
+                RTmask |= (1LL << baseid);
+                memcpy(refsp->RTbufs[baseid+1],buf,sizeof(refsp->RTbufs[baseid+1]));
+                if ( refid != 0 )
+                    memcpy(refsp->RTbufs[0],buf,sizeof(refsp->RTbufs[0]));
+            }
+            // the file is kept current for daemons without the segment, only rewritten on a change or before it would look stale
+            if ( komodo_rtslot_write(baseid,buf) != 0 || buf[0] != lastRTfile[0] || buf[1] != lastRTfile[1] || (buf[2] == 0) != (lastRTfile[2] == 0) || buf[2] >= lastRTfile[2]+KOMODO_RTFILE_INTERVAL )
             {
-                buf[0] = (uint32_t)chainActive.Tip()->nHeight;
-                buf[1] = (uint32_t)komodo_longestchain();
-                if ( buf[0] != 0 && buf[0] == buf[1] )
+                memcpy(lastRTfile,buf,sizeof(lastRTfile));
+                if ( RTfps[baseid] == 0 )
                 {
-                    buf[2] = (uint32_t)time(NULL);
-                    RTmask |= (1LL << baseid);
-                    memcpy(refsp->RTbufs[baseid+1],buf,sizeof(refsp->RTbufs[baseid+1]));
-                    if ( refid != 0 )
-                        memcpy(refsp->RTbufs[0],buf,sizeof(refsp->RTbufs[0]));
+                    komodo_statefname(fname,baseid<32?base:(char *)"",(char *)"realtime");
+                    RTfps[baseid] = fopen(fname,"wb");
                 }
-                if ( fwrite(buf,1,sizeof(buf),fp) != sizeof(buf) )
-                    fprintf(stderr,"[%s] %s error writing realtime\n",ASSETCHAINS_SYMBOL,base);
-                fclose(fp);
-            } else fprintf(stderr,"%s create error RT\n",base);
+                if ( (fp= RTfps[baseid]) != 0 )
+                {
+                    fseek(fp,0,SEEK_SET);
+                    if ( fwrite(buf,1,sizeof(buf),fp) != sizeof(buf) )
+                        fprintf(stderr,"[%s] %s error writing realtime\n",ASSETCHAINS_SYMBOL,base);
+                    fflush(fp);
+                } else fprintf(stderr,"%s create error RT\n",base);
+            }
         }
         if ( sp != 0 && isrealtime == 0 )
             refsp->RTbufs[0][2] = 0;
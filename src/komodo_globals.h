@@ -24,6 +24,7 @@ char *komodo_issuemethod(char *userpass,char *method,char *params,uint16_t port)
 void komodo_init(int32_t height);
 void komodo_assetchain_pubkeys(char *jsonstr);
 int32_t komodo_chosennotary(int32_t *notaryidp,int32_t height,uint8_t *pubkey33,uint32_t timestamp);
+int32_t komodo_notaryera(int32_t height,uint32_t timestamp);
 int32_t komodo_isrealtime(int32_t *kmdheightp);
 uint64_t komodo_paxtotal();
 int32_t komodo_longestchain();
@@ -31,16 +32,19 @@ uint64_t komodo_maxallowed(int32_t baseid);
 int32_t komodo_bannedset(int32_t *indallvoutsp,uint256 *array,int32_t max);
 
 pthread_mutex_t komodo_mutex;
+int32_t KOMODO_NOTARYSET_GEN; // bumped whenever the Pubkeys eras change
 
 #define KOMODO_ELECTION_GAP 2000    //((ASSETCHAINS_SYMBOL[0] == 0) ? 2000 : 100)
 #define IGUANA_MAXSCRIPTSIZE 10001
 #define KOMODO_ASSETCHAIN_MAXLEN 65
 
-struct pax_transaction *PAX;
-int32_t NUM_PRICES; uint32_t *PVALS;
+struct pax_transaction *PAX,**PAX_PENDING; int32_t NUM_PAX_PENDING,MAX_PAX_PENDING; // PAX_PENDING holds every unmarked entry of PAX, guarded by komodo_mutex
+int32_t NUM_PRICES,KOMODO_PVALS_REWINDS; uint32_t *PVALS; // REWINDS counts every time existing PVALS rows were dropped or replaced
 struct knotaries_entry *Pubkeys;
+struct knotaries_snapshot **Pubkeys_snapshot; // per era, read without komodo_mutex
 
 struct komodo_state KOMODO_STATES[34];
+struct komodo_journal KOMODO_STATEJOURNAL,KOMODO_SIGNEDJOURNAL; int32_t KOMODO_CONNECTING,KOMODO_STATESYNC; // STATESYNC: fsync 0 only at shutdown, 1 after every block, N at most every N milliseconds
 
 #define _COINBASE_MATURITY 100
 int COINBASE_MATURITY = _COINBASE_MATURITY;//100;
@@ -60,5 +64,4 @@ uint32_t KOMODO_INITDONE;
 char KMDUSERPASS[4096],BTCUSERPASS[4096]; uint16_t KMD_PORT = 7771,BITCOIND_PORT = 7771;
 uint64_t PENDING_KOMODO_TX;
 
-struct komodo_kv *KOMODO_KV;
 pthread_mutex_t KOMODO_KV_mutex;
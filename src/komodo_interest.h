@@ -200,3 +200,33 @@ uint64_t komodo_interest(int32_t txheight,uint64_t nValue,uint32_t nLockTime,uin
     return(interest);
 }
 
+
+// batch form of komodo_interest() for many outputs against one tiptime, bit-identical to the scalar path.
+// the first pass selects between the two post-250000 formulas with masks, it still runs scalar since the
+// 64 bit divisions do not vectorize. the second pass branches per output and redoes the older ones
+// (special cased exceptions, pre-activation rounding) with komodo_interest()
+void komodo_interest_batch(uint64_t *interests,const uint64_t *values,const uint32_t *locktimes,const int32_t *txheights,int32_t n,uint32_t tiptime)
+{
+    int32_t i; uint64_t nValue,valid,modern,minutes,a,b; uint32_t nLockTime,activation = 1491350400;
+    if ( ASSETCHAINS_SYMBOL[0] != 0 )
+    {
+        memset(interests,0,sizeof(*interests) * n);
+        return;
+    }
+    for (i=0; i<n; i++)
+    {
+        nValue = values[i], nLockTime = locktimes[i];
+        minutes = (uint32_t)(tiptime - nLockTime) / 60;
+        valid = (txheights[i] < KOMODO_ENDOFERA) & (nLockTime >= LOCKTIME_THRESHOLD) & (tiptime != 0) & (nLockTime < tiptime) & (nValue >= 10*COIN) & (minutes >= 60);
+        minutes = (minutes > 365 * 24 * 60 ? 365 * 24 * 60 : minutes) - 59;
+        modern = (txheights[i] >= 1000000);
+        a = (nValue / 10512000) * minutes; // _komodo_interestnew()
+        b = ((nValue / 20) * minutes) / ((uint64_t)365 * 24 * 60);
+        interests[i] = (-valid) & (((-modern) & a) | ((modern - 1) & b));
+    }
+    for (i=0; i<n; i++)
+    {
+        if ( txheights[i] < 250000 || (tiptime < activation && values[i] <= 25000LL*COIN) )
+            interests[i] = komodo_interest(txheights[i],values[i],locktimes[i],tiptime);
+    }
+}
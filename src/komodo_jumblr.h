@@ -28,6 +28,7 @@
 #include <wincrypt.h>
 #endif
 #include "komodo_defs.h"
+#include "rpcserver.h"
 
 #define JUMBLR_ADDR "RGhxXpXSSBTBm9EvNsXnTQczthMCxHX91t"
 #define JUMBLR_BTCADDR "18RmTJe9qMech8siuhYfMtHo8RtcN1obC6"
@@ -54,29 +55,27 @@ struct jumblr_item
 char Jumblr_secretaddrs[JUMBLR_MAXSECRETADDRS][64],Jumblr_deposit[64];
 int32_t Jumblr_numsecretaddrs; // if 0 -> run silent mode
 
+// dispatched straight into this daemon's RPC table, no loopback HTTP/auth. userpass and port are unused
 char *jumblr_issuemethod(char *userpass,char *method,char *params,uint16_t port)
 {
-    cJSON *retjson,*resjson = 0; char *retstr;
-    if ( (retstr= komodo_issuemethod(userpass,method,params,port)) != 0 )
+    UniValue jparams(UniValue::VARR),result,errobj(UniValue::VOBJ); std::string retstr;
+    if ( params != 0 && params[0] != 0 && jparams.read(params) == 0 )
+        return(clonestr((char *)"{\"error\":\"cant parse params\"}"));
+    try
     {
-        if ( (retjson= cJSON_Parse(retstr)) != 0 )
-        {
-            if ( jobj(retjson,(char *)"result") != 0 )
-                resjson = jduplicate(jobj(retjson,(char *)"result"));
-            else if ( jobj(retjson,(char *)"error") != 0 )
-                resjson = jduplicate(jobj(retjson,(char *)"error"));
-            else
-            {
-                resjson = cJSON_CreateObject();
-                jaddstr(resjson,(char *)"error",(char *)"cant parse return");
-            }
-            free_json(retjson);
-        }
-        free(retstr);
+        result = tableRPC.execute(method,jparams);
+        retstr = result.write();
+    }
+    catch (const UniValue& objError)
+    {
+        retstr = objError.write();
+    }
+    catch (const std::exception& e)
+    {
+        errobj.push_back(Pair("error",e.what()));
+        retstr = errobj.write();
     }
-    if ( resjson != 0 )
-        return(jprint(resjson,1));
-    else return(clonestr((char *)"{\"error\":\"unknown error\"}"));
+    return(clonestr((char *)retstr.c_str()));
 }
 
 char *jumblr_importaddress(char *address)
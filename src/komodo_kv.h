@@ -17,6 +17,63 @@
 #define H_KOMODOKV_H
 
 #include "komodo_defs.h"
+#include "leveldbwrapper.h"
+
+#define KOMODO_KVDB_CACHE (8 << 20)
+#define KOMODO_KVUNDODEPTH (KOMODO_KVDURATION * 2)
+#define KOMODO_KVPRUNEDEPTH KOMODO_KVDURATION // updates declaring a height further back are rejected, so records that expired before it can never be matched again
+
+// kvstore leveldb layout, heights are big endian so cursors walk them in height order
+// 'k' key -> komodo_kvrecord
+// 'e' expiry key -> expiry queue, consumed from the front by komodo_kvprune
+// 'u' height seq -> komodo_kvundo, undo log for reorgs, kept for KOMODO_KVUNDODEPTH blocks
+// 'a' height txid vout -> update already applied, lets a komodostate replay skip it
+// 'h' -> every update at or below this height is applied
+
+struct komodo_kvdbkey
+{
+    std::vector<uint8_t> buf;
+    unsigned int GetSerializeSize(int nType,int nVersion) const { return((unsigned int)buf.size()); }
+    template <typename Stream> void Serialize(Stream &s,int nType,int nVersion) const
+    {
+        if ( buf.size() > 0 )
+            s.write((char *)&buf[0],buf.size());
+    }
+};
+
+struct komodo_kvrecord
+{
+    uint256 pubkey; int32_t height; uint32_t flags; std::vector<uint8_t> value;
+    ADD_SERIALIZE_METHODS;
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action, int nType, int nVersion) {
+        READWRITE(pubkey);
+        READWRITE(height);
+        READWRITE(flags);
+        READWRITE(value);
+    }
+};
+
+struct komodo_kvundo
+{
+    std::vector<uint8_t> key; uint8_t existed; struct komodo_kvrecord prev;
+    ADD_SERIALIZE_METHODS;
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action, int nType, int nVersion) {
+        READWRITE(key);
+        READWRITE(existed);
+        READWRITE(prev);
+    }
+};
+
+CLevelDBWrapper *KOMODO_KVDB;
+int32_t KOMODO_KVDB_HEIGHT,KOMODO_KVDB_LOADED,KOMODO_KVUNDO_HEIGHT = -1; uint32_t KOMODO_KVUNDO_SEQ;
+
+// kv updates sitting in the mempool, parsed once when accepted and dropped when mined or evicted
+struct komodo_kvpending { uint256 txid,pubkey; int32_t height; uint32_t flags; uint16_t vout; std::vector<uint8_t> value; };
+std::map<std::vector<uint8_t>,std::vector<struct komodo_kvpending> > KOMODO_KVPENDING;
+std::multimap<uint256,std::vector<uint8_t> > KOMODO_KVPENDING_TXIDS;
+pthread_mutex_t KOMODO_KVPENDING_mutex = PTHREAD_MUTEX_INITIALIZER;
 
 int32_t komodo_kvcmp(uint8_t *refvalue,uint16_t refvaluesize,uint8_t *value,uint16_t valuesize)
 {
@@ -53,54 +110,302 @@ uint64_t komodo_kvfee(uint32_t flags,int32_t opretlen,int32_t keylen)
     return(fee);
 }
 
+struct komodo_kvdbkey komodo_kvdbkey_make(uint8_t type,int32_t height,const uint8_t *suffix,int32_t len)
+{
+    struct komodo_kvdbkey dbkey; int32_t i;
+    dbkey.buf.reserve(5 + len);
+    dbkey.buf.push_back(type);
+    if ( height >= 0 )
+    {
+        for (i=3; i>=0; i--)
+            dbkey.buf.push_back((uint8_t)((uint32_t)height >> (i * 8)));
+    }
+    if ( len > 0 )
+        dbkey.buf.insert(dbkey.buf.end(),suffix,suffix + len);
+    return(dbkey);
+}
+
+struct komodo_kvdbkey komodo_kvdbkey_slice(const leveldb::Slice &slKey)
+{
+    struct komodo_kvdbkey dbkey;
+    dbkey.buf.assign((uint8_t *)slKey.data(),(uint8_t *)slKey.data() + slKey.size());
+    return(dbkey);
+}
+
+// height following the type byte, -1 if slKey is not a height keyed entry of this type
+int32_t komodo_kvdbkey_height(const leveldb::Slice &slKey,uint8_t type)
+{
+    const uint8_t *ptr = (const uint8_t *)slKey.data();
+    if ( slKey.size() < 5 || ptr[0] != type )
+        return(-1);
+    return((int32_t)(((uint32_t)ptr[1] << 24) | ((uint32_t)ptr[2] << 16) | ((uint32_t)ptr[3] << 8) | ptr[4]));
+}
+
+leveldb::Iterator *komodo_kvdb_seek(CLevelDBWrapper *db,uint8_t type,int32_t height)
+{
+    leveldb::Iterator *pcursor = db->NewIterator(); struct komodo_kvdbkey first = komodo_kvdbkey_make(type,height,0,0);
+    pcursor->Seek(leveldb::Slice((char *)&first.buf[0],first.buf.size()));
+    return(pcursor);
+}
+
+CLevelDBWrapper *komodo_kvdb()
+{
+    CLevelDBWrapper *db; char fname[512];
+    if ( (db= __atomic_load_n(&KOMODO_KVDB,__ATOMIC_ACQUIRE)) == 0 )
+    {
+        portable_mutex_lock(&KOMODO_KV_mutex);
+        if ( (db= KOMODO_KVDB) == 0 )
+        {
+            komodo_statefname(fname,ASSETCHAINS_SYMBOL,(char *)"kvstore");
+            db = new CLevelDBWrapper(boost::filesystem::path(fname),KOMODO_KVDB_CACHE);
+            if ( db->Read(komodo_kvdbkey_make('h',-1,0,0),KOMODO_KVDB_HEIGHT) == 0 )
+                KOMODO_KVDB_HEIGHT = 0;
+            KOMODO_KVDB_LOADED = KOMODO_KVDB_HEIGHT;
+            __atomic_store_n(&KOMODO_KVDB,db,__ATOMIC_RELEASE);
+        }
+        portable_mutex_unlock(&KOMODO_KV_mutex);
+    }
+    return(db);
+}
+
+int32_t komodo_kvexpiry(const struct komodo_kvrecord &rec)
+{
+    return(rec.height + komodo_kvduration(rec.flags));
+}
+
+// replace (or erase when rec is null) the record for key, keeping the expiry queue in step
+void komodo_kvdb_put(CLevelDBBatch &batch,const std::vector<uint8_t> &key,const struct komodo_kvrecord *prev,const struct komodo_kvrecord *rec)
+{
+    if ( prev != 0 )
+        batch.Erase(komodo_kvdbkey_make('e',komodo_kvexpiry(*prev),key.data(),(int32_t)key.size()));
+    if ( rec != 0 )
+    {
+        batch.Write(komodo_kvdbkey_make('k',-1,key.data(),(int32_t)key.size()),*rec);
+        batch.Write(komodo_kvdbkey_make('e',komodo_kvexpiry(*rec),key.data(),(int32_t)key.size()),(uint8_t)0);
+    } else batch.Erase(komodo_kvdbkey_make('k',-1,key.data(),(int32_t)key.size()));
+}
+
+void komodo_kvdb_undo(CLevelDBBatch &batch,CLevelDBWrapper *db,int32_t height,const std::vector<uint8_t> &key,const struct komodo_kvrecord *prev)
+{
+    struct komodo_kvundo U; uint8_t seqbuf[4]; int32_t i;
+    if ( height != KOMODO_KVUNDO_HEIGHT )
+    {
+        boost::scoped_ptr<leveldb::Iterator> pcursor(komodo_kvdb_seek(db,'u',height));
+        for (KOMODO_KVUNDO_SEQ=0; pcursor->Valid() && komodo_kvdbkey_height(pcursor->key(),'u') == height; pcursor->Next())
+            KOMODO_KVUNDO_SEQ++;
+        KOMODO_KVUNDO_HEIGHT = height;
+    }
+    for (i=0; i<4; i++)
+        seqbuf[i] = (uint8_t)(KOMODO_KVUNDO_SEQ >> ((3 - i) * 8));
+    KOMODO_KVUNDO_SEQ++;
+    U.key = key;
+    if ( (U.existed= (prev != 0)) != 0 )
+        U.prev = *prev;
+    else U.prev.height = 0, U.prev.flags = 0;
+    batch.Write(komodo_kvdbkey_make('u',height,seqbuf,sizeof(seqbuf)),U);
+}
+
+struct komodo_kvdbkey komodo_kvdb_appliedkey(int32_t height,uint256 txid,uint16_t vout)
+{
+    uint8_t buf[sizeof(txid) + sizeof(vout)];
+    memcpy(buf,&txid,sizeof(txid));
+    buf[sizeof(txid)] = (uint8_t)(vout >> 8);
+    buf[sizeof(txid) + 1] = (uint8_t)vout;
+    return(komodo_kvdbkey_make('a',height,buf,sizeof(buf)));
+}
+
 int32_t komodo_kvsearch(uint256 *pubkeyp,int32_t current_height,uint32_t *flagsp,int32_t *heightp,uint8_t value[IGUANA_MAXSCRIPTSIZE],uint8_t *key,int32_t keylen)
 {
-    struct komodo_kv *ptr; int32_t duration,retval = -1;
+    struct komodo_kvrecord rec; int32_t retval = -1;
     *heightp = -1;
     *flagsp = 0;
     memset(pubkeyp,0,sizeof(*pubkeyp));
-    portable_mutex_lock(&KOMODO_KV_mutex);
-    HASH_FIND(hh,KOMODO_KV,key,keylen,ptr);
-    if ( ptr != 0 )
+    if ( ASSETCHAINS_SYMBOL[0] == 0 )
+        return(-1);
+    // leveldb reads need no lock, expired records stay until komodo_kvprune drops them
+    if ( komodo_kvdb()->Read(komodo_kvdbkey_make('k',-1,key,keylen),rec) != 0 && current_height <= komodo_kvexpiry(rec) )
     {
-        duration = komodo_kvduration(ptr->flags);
-        //printf("duration.%d flags.%d current.%d ht.%d keylen.%d valuesize.%d\n",duration,ptr->flags,current_height,ptr->height,ptr->keylen,ptr->valuesize);
-        if ( current_height > (ptr->height + duration) )
+        //printf("flags.%d current.%d ht.%d keylen.%d valuesize.%d\n",rec.flags,current_height,rec.height,keylen,(int32_t)rec.value.size());
+        *heightp = rec.height;
+        *flagsp = rec.flags;
+        *pubkeyp = rec.pubkey;
+        if ( (retval= (int32_t)rec.value.size()) > 0 )
+            memcpy(value,&rec.value[0],retval);
+    }
+    return(retval); // mempool updates are in KOMODO_KVPENDING, see komodo_kvpending_search
+}
+
+void komodo_kvpending_add(const CTransaction &tx)
+{
+    static uint256 zeroes;
+    struct komodo_kvpending P; uint8_t *script,*opret,*key,*valueptr,keyvalue[IGUANA_MAXSCRIPTSIZE]; uint256 txid,pubkey,refpubkey,sig; uint32_t flags,refflags; int32_t i,j,k,len,opretlen,coresize,height,kvheight,refvaluesize; uint16_t keylen,valuesize;
+    if ( ASSETCHAINS_SYMBOL[0] == 0 )
+        return;
+    txid = tx.GetHash();
+    for (j=0; j<tx.vout.size(); j++)
+    {
+        script = (uint8_t *)tx.vout[j].scriptPubKey.data();
+        if ( (len= (int32_t)tx.vout[j].scriptPubKey.size()) < 2 || script[0] != 0x6a )
+            continue;
+        k = 1;
+        if ( (opretlen= script[k++]) == 0x4c )
         {
-            HASH_DELETE(hh,KOMODO_KV,ptr);
-            if ( ptr->value != 0 )
-                free(ptr->value);
-            if ( ptr->key != 0 )
-                free(ptr->key);
-            free(ptr);
+            if ( k+1 > len )
+                continue;
+            opretlen = script[k++];
         }
-        else
+        else if ( opretlen == 0x4d )
         {
-            *heightp = ptr->height;
-            *flagsp = ptr->flags;
-            int32_t i; for (i=0; i<32; i++)
-            {
-                //printf("%02x",((uint8_t *)&ptr->pubkey)[31-i]);
-                ((uint8_t *)pubkeyp)[i] = ((uint8_t *)&ptr->pubkey)[31-i];
-            }
-            //printf(" ptr->pubkey\n");
-            memcpy(pubkeyp,&ptr->pubkey,sizeof(*pubkeyp));
-            if ( (retval= ptr->valuesize) > 0 )
-                memcpy(value,ptr->value,retval);
+            if ( k+2 > len )
+                continue;
+            opretlen = script[k++];
+            opretlen += (script[k++] << 8);
+        }
+        opret = &script[k];
+        // same acceptance rules as komodo_kvupdate, minus the state change
+        if ( k+opretlen > len || opretlen < 13 || opret[0] != 'K' || opretlen == 40 )
+            continue;
+        iguana_rwnum(0,&opret[1],sizeof(keylen),&keylen);
+        iguana_rwnum(0,&opret[3],sizeof(valuesize),&valuesize);
+        iguana_rwnum(0,&opret[5],sizeof(height),&height);
+        iguana_rwnum(0,&opret[9],sizeof(flags),&flags);
+        key = &opret[13];
+        valueptr = &key[keylen];
+        coresize = (int32_t)(sizeof(flags)+sizeof(height)+sizeof(keylen)+sizeof(valuesize)+keylen+valuesize+1);
+        if ( keylen+13 > opretlen || (uint64_t)tx.vout[j].nValue < komodo_kvfee(flags,opretlen,keylen) || (opretlen != coresize && opretlen != coresize+sizeof(uint256) && opretlen != coresize+2*sizeof(uint256)) )
+            continue;
+        if ( height < chainActive.Height()+1 - KOMODO_KVPRUNEDEPTH )
+            continue;
+        memset(&pubkey,0,sizeof(pubkey));
+        memset(&sig,0,sizeof(sig));
+        if ( opretlen >= coresize+sizeof(uint256) )
+        {
+            for (i=0; i<32; i++)
+                ((uint8_t *)&pubkey)[i] = opret[coresize+i];
         }
+        if ( opretlen == coresize+sizeof(uint256)*2 )
+        {
+            for (i=0; i<32; i++)
+                ((uint8_t *)&sig)[i] = opret[coresize+sizeof(uint256)+i];
+        }
+        memcpy(keyvalue,key,keylen);
+        if ( (refvaluesize= komodo_kvsearch(&refpubkey,height,&refflags,&kvheight,&keyvalue[keylen],key,keylen)) >= 0 && memcmp(&zeroes,&refpubkey,sizeof(refpubkey)) != 0 && komodo_kvsigverify(keyvalue,keylen+refvaluesize,refpubkey,sig) < 0 )
+            continue;
+        P.txid = txid;
+        P.vout = j;
+        P.pubkey = pubkey;
+        P.height = height;
+        P.flags = flags;
+        P.value.assign(valueptr,valueptr + valuesize);
+        std::vector<uint8_t> vkey(key,key + keylen);
+        pthread_mutex_lock(&KOMODO_KVPENDING_mutex);
+        KOMODO_KVPENDING[vkey].push_back(P);
+        KOMODO_KVPENDING_TXIDS.insert(std::make_pair(txid,vkey));
+        pthread_mutex_unlock(&KOMODO_KVPENDING_mutex);
     }
-    portable_mutex_unlock(&KOMODO_KV_mutex);
-    if ( retval < 0 )
+}
+
+void komodo_kvpending_remove(const CTransaction &tx)
+{
+    std::pair<std::multimap<uint256,std::vector<uint8_t> >::iterator,std::multimap<uint256,std::vector<uint8_t> >::iterator> range; std::map<std::vector<uint8_t>,std::vector<struct komodo_kvpending> >::iterator it; uint256 txid; int32_t i;
+    pthread_mutex_lock(&KOMODO_KVPENDING_mutex);
+    if ( KOMODO_KVPENDING_TXIDS.size() > 0 )
     {
-        // search rawmempool
+        txid = tx.GetHash();
+        range = KOMODO_KVPENDING_TXIDS.equal_range(txid);
+        for (; range.first!=range.second; KOMODO_KVPENDING_TXIDS.erase(range.first++))
+        {
+            if ( (it= KOMODO_KVPENDING.find(range.first->second)) == KOMODO_KVPENDING.end() )
+                continue;
+            std::vector<struct komodo_kvpending> &updates = it->second;
+            for (i=(int32_t)updates.size()-1; i>=0; i--)
+                if ( updates[i].txid == txid )
+                    updates.erase(updates.begin() + i);
+            if ( updates.size() == 0 )
+                KOMODO_KVPENDING.erase(it);
+        }
+    }
+    pthread_mutex_unlock(&KOMODO_KVPENDING_mutex);
+}
+
+void komodo_kvpending_clear()
+{
+    pthread_mutex_lock(&KOMODO_KVPENDING_mutex);
+    KOMODO_KVPENDING.clear();
+    KOMODO_KVPENDING_TXIDS.clear();
+    pthread_mutex_unlock(&KOMODO_KVPENDING_mutex);
+}
+
+// most recently accepted mempool update for key, -1 if none
+int32_t komodo_kvpending_search(uint256 *txidp,uint256 *pubkeyp,int32_t *heightp,uint32_t *flagsp,uint8_t value[IGUANA_MAXSCRIPTSIZE],uint8_t *key,int32_t keylen)
+{
+    std::map<std::vector<uint8_t>,std::vector<struct komodo_kvpending> >::iterator it; int32_t retval = -1;
+    pthread_mutex_lock(&KOMODO_KVPENDING_mutex);
+    if ( (it= KOMODO_KVPENDING.find(std::vector<uint8_t>(key,key + keylen))) != KOMODO_KVPENDING.end() && it->second.size() > 0 )
+    {
+        struct komodo_kvpending &P = it->second.back();
+        *txidp = P.txid;
+        *pubkeyp = P.pubkey;
+        *heightp = P.height;
+        *flagsp = P.flags;
+        if ( (retval= (int32_t)P.value.size()) > 0 )
+            memcpy(value,&P.value[0],retval);
     }
+    pthread_mutex_unlock(&KOMODO_KVPENDING_mutex);
     return(retval);
 }
 
-void komodo_kvupdate(uint8_t *opretbuf,int32_t opretlen,uint64_t value)
+// end of the key range sharing prefix, returns -1 when there is no upper bound (empty or all 0xff prefix)
+int32_t komodo_kvprefixend(uint8_t *end,uint8_t *prefix,int32_t prefixlen)
+{
+    int32_t len = prefixlen;
+    while ( len > 0 && prefix[len-1] == 0xff )
+        len--;
+    if ( len == 0 )
+        return(-1);
+    memcpy(end,prefix,len);
+    end[len-1]++;
+    return(len);
+}
+
+// walks live records with from <= key < to in key order (no upper bound when to is null), handing each to func
+// without materialising the range. the leveldb iterator reads a consistent snapshot so writers are not blocked
+int32_t komodo_kvscan(int32_t current_height,uint8_t *from,int32_t fromlen,uint8_t *to,int32_t tolen,int32_t limit,int32_t (*func)(void *arg,uint8_t *key,int32_t keylen,uint256 pubkey,int32_t height,uint32_t flags,uint8_t *value,int32_t valuesize),void *arg)
+{
+    struct komodo_kvrecord rec; struct komodo_kvdbkey first; int32_t n = 0;
+    if ( ASSETCHAINS_SYMBOL[0] == 0 || limit <= 0 )
+        return(0);
+    first = komodo_kvdbkey_make('k',-1,from,fromlen);
+    boost::scoped_ptr<leveldb::Iterator> pcursor(komodo_kvdb()->NewIterator());
+    for (pcursor->Seek(leveldb::Slice((char *)&first.buf[0],first.buf.size())); pcursor->Valid() && n < limit; pcursor->Next())
+    {
+        leveldb::Slice slKey = pcursor->key();
+        if ( slKey.size() < 1 || slKey[0] != 'k' )
+            break;
+        leveldb::Slice slUserKey(slKey.data() + 1,slKey.size() - 1);
+        if ( to != 0 && slUserKey.compare(leveldb::Slice((char *)to,tolen)) >= 0 )
+            break;
+        try {
+            leveldb::Slice slValue = pcursor->value();
+            CDataStream ssValue(slValue.data(),slValue.data() + slValue.size(),SER_DISK,CLIENT_VERSION);
+            ssValue >> rec;
+        } catch (const std::exception& e) {
+            fprintf(stderr,"komodo_kvscan record error %s\n",e.what());
+            break;
+        }
+        if ( current_height > komodo_kvexpiry(rec) )
+            continue;
+        n++;
+        if ( (*func)(arg,(uint8_t *)slUserKey.data(),(int32_t)slUserKey.size(),rec.pubkey,rec.height,rec.flags,rec.value.data(),(int32_t)rec.value.size()) < 0 )
+            break;
+    }
+    return(n);
+}
+
+void komodo_kvupdate(uint8_t *opretbuf,int32_t opretlen,uint64_t value,int32_t txheight,uint256 txid,uint16_t vout)
 {
     static uint256 zeroes;
-    uint32_t flags; uint256 pubkey,refpubkey,sig; int32_t i,refvaluesize,hassig,coresize,haspubkey,height,kvheight; uint16_t keylen,valuesize,newflag = 0; uint8_t *key,*valueptr,keyvalue[IGUANA_MAXSCRIPTSIZE]; struct komodo_kv *ptr; char *transferpubstr,*tstr; uint64_t fee;
+    uint32_t flags; uint256 pubkey,refpubkey,sig; int32_t i,refvaluesize,hassig,coresize,haspubkey,height,kvheight,existed; uint16_t keylen,valuesize,newflag = 0; uint8_t *key,*valueptr,keyvalue[IGUANA_MAXSCRIPTSIZE]; struct komodo_kvrecord prev,rec; char *transferpubstr,*tstr; uint64_t fee; CLevelDBWrapper *db; CLevelDBBatch batch;
     if ( ASSETCHAINS_SYMBOL[0] == 0 ) // disable KV for KMD
         return;
     iguana_rwnum(0,&opretbuf[1],sizeof(keylen),&keylen);
@@ -123,6 +428,14 @@ void komodo_kvupdate(uint8_t *opretbuf,int32_t opretlen,uint64_t value)
         coresize = (int32_t)(sizeof(flags)+sizeof(height)+sizeof(keylen)+sizeof(valuesize)+keylen+valuesize+1);
         if ( opretlen == coresize || opretlen == coresize+sizeof(uint256) || opretlen == coresize+2*sizeof(uint256) )
         {
+            db = komodo_kvdb();
+            if ( txheight <= KOMODO_KVDB_HEIGHT || db->Exists(komodo_kvdb_appliedkey(txheight,txid,vout)) != 0 )
+                return; // komodostate replay of an update the kvstore already has
+            if ( height < txheight - KOMODO_KVPRUNEDEPTH ) // its key may already be pruned, matching it would depend on when this node last pruned
+            {
+                printf("komodo_kvupdate: declared ht.%d too far below ht.%d, ignored\n",height,txheight);
+                return;
+            }
             memset(&pubkey,0,sizeof(pubkey));
             memset(&sig,0,sizeof(sig));
             if ( (haspubkey= (opretlen >= coresize+sizeof(uint256))) != 0 )
@@ -147,11 +460,13 @@ void komodo_kvupdate(uint8_t *opretbuf,int32_t opretlen,uint64_t value)
                     }
                 }
             }
+            std::vector<uint8_t> vkey(key,key + keylen);
             portable_mutex_lock(&KOMODO_KV_mutex);
-            HASH_FIND(hh,KOMODO_KV,key,keylen,ptr);
-            if ( ptr != 0 )
+            existed = db->Read(komodo_kvdbkey_make('k',-1,key,keylen),prev);
+            if ( existed != 0 && height <= komodo_kvexpiry(prev) )
             {
-                //if ( (ptr->flags & KOMODO_KVPROTECTED) != 0 )
+                rec = prev;
+                //if ( (rec.flags & KOMODO_KVPROTECTED) != 0 )
                 {
                     tstr = (char *)"transfer:";
                     transferpubstr = (char *)&valueptr[strlen(tstr)];
@@ -163,38 +478,145 @@ void komodo_kvupdate(uint8_t *opretbuf,int32_t opretlen,uint64_t value)
                     }
                 }
             }
-            else if ( ptr == 0 )
+            else
             {
-                ptr = (struct komodo_kv *)calloc(1,sizeof(*ptr));
-                ptr->key = (uint8_t *)calloc(1,keylen);
-                ptr->keylen = keylen;
-                memcpy(ptr->key,key,keylen);
+                // new key, or the old one expired at this height
+                rec.flags = 0;
                 newflag = 1;
-                HASH_ADD_KEYPTR(hh,KOMODO_KV,ptr->key,ptr->keylen,ptr);
-                printf("KV add.(%s) (%s)\n",ptr->key,valueptr);
+                printf("KV add.(%s) (%s)\n",key,valueptr);
             }
-            if ( newflag != 0 || (ptr->flags & KOMODO_KVPROTECTED) == 0 )
+            if ( newflag != 0 || (rec.flags & KOMODO_KVPROTECTED) == 0 )
+                rec.value.assign(valueptr,valueptr + valuesize);
+            rec.pubkey = pubkey;
+            rec.height = height;
+            rec.flags = flags | 1;
+            komodo_kvdb_undo(batch,db,txheight,vkey,existed != 0 ? &prev : 0);
+            komodo_kvdb_put(batch,vkey,existed != 0 ? &prev : 0,&rec);
+            batch.Write(komodo_kvdb_appliedkey(txheight,txid,vout),(uint8_t)0);
+            if ( txheight-1 > KOMODO_KVDB_HEIGHT )
             {
-                if ( ptr->value != 0 )
-                    free(ptr->value), ptr->value = 0;
-                if ( (ptr->valuesize= valuesize) != 0 )
-                {
-                    ptr->value = (uint8_t *)calloc(1,valuesize);
-                    memcpy(ptr->value,valueptr,valuesize);
-                }
+                KOMODO_KVDB_HEIGHT = txheight-1;
+                batch.Write(komodo_kvdbkey_make('h',-1,0,0),KOMODO_KVDB_HEIGHT);
             }
-            /*for (i=0; i<32; i++)
-                printf("%02x",((uint8_t *)&ptr->pubkey)[i]);
-            printf(" <- ");
-            for (i=0; i<32; i++)
-                printf("%02x",((uint8_t *)&pubkey)[i]);
-            printf(" new pubkey\n");*/
-            memcpy(&ptr->pubkey,&pubkey,sizeof(ptr->pubkey));
-            ptr->height = height;
-            ptr->flags = flags | 1;
+            db->WriteBatch(batch);
             portable_mutex_unlock(&KOMODO_KV_mutex);
         } //else printf("size mismatch %d vs %d\n",opretlen,coresize);
     } 
 }
 
+// called once a block is connected: drop what expired more than KOMODO_KVPRUNEDEPTH ago, forget undo data below the reorg horizon
+void komodo_kvprune(int32_t height)
+{
+    CLevelDBWrapper *db; CLevelDBBatch batch; struct komodo_kvrecord rec; int32_t expiry; uint8_t type; const char *types = "ua";
+    if ( ASSETCHAINS_SYMBOL[0] == 0 )
+        return;
+    db = komodo_kvdb();
+    portable_mutex_lock(&KOMODO_KV_mutex);
+    {
+        boost::scoped_ptr<leveldb::Iterator> pcursor(komodo_kvdb_seek(db,'e',0));
+        for (; pcursor->Valid() && (expiry= komodo_kvdbkey_height(pcursor->key(),'e')) >= 0 && expiry < height; pcursor->Next())
+        {
+            leveldb::Slice slKey = pcursor->key();
+            std::vector<uint8_t> key((uint8_t *)slKey.data() + 5,(uint8_t *)slKey.data() + slKey.size());
+            if ( db->Read(komodo_kvdbkey_make('k',-1,key.data(),(int32_t)key.size()),rec) != 0 && komodo_kvexpiry(rec) == expiry )
+            {
+                komodo_kvdb_undo(batch,db,height,key,&rec);
+                komodo_kvdb_put(batch,key,&rec,0);
+            } else batch.Erase(komodo_kvdbkey_slice(slKey));
+        }
+    }
+    while ( (type= *types++) != 0 )
+    {
+        boost::scoped_ptr<leveldb::Iterator> pcursor(komodo_kvdb_seek(db,type,0));
+        for (; pcursor->Valid() && komodo_kvdbkey_height(pcursor->key(),type) >= 0 && komodo_kvdbkey_height(pcursor->key(),type) < height - KOMODO_KVUNDODEPTH; pcursor->Next())
+            batch.Erase(komodo_kvdbkey_slice(pcursor->key()));
+    }
+    if ( height > KOMODO_KVDB_HEIGHT )
+    {
+        KOMODO_KVDB_HEIGHT = height;
+        batch.Write(komodo_kvdbkey_make('h',-1,0,0),KOMODO_KVDB_HEIGHT);
+    }
+    db->WriteBatch(batch);
+    portable_mutex_unlock(&KOMODO_KV_mutex);
+}
+
+// release the kvstore at shutdown, the destructor closes leveldb so nothing is left unsynced
+void komodo_kvclose()
+{
+    CLevelDBWrapper *db;
+    portable_mutex_lock(&KOMODO_KV_mutex);
+    if ( (db= KOMODO_KVDB) != 0 )
+    {
+        __atomic_store_n(&KOMODO_KVDB,(CLevelDBWrapper *)0,__ATOMIC_RELEASE);
+        delete db;
+    }
+    portable_mutex_unlock(&KOMODO_KV_mutex);
+}
+
+// undo every kv change made at or above height
+void komodo_kvrewind(int32_t height)
+{
+    CLevelDBWrapper *db; CLevelDBBatch batch; struct komodo_kvundo U; struct komodo_kvrecord cur; std::map<std::vector<uint8_t>,struct komodo_kvundo> oldest; std::map<std::vector<uint8_t>,struct komodo_kvundo>::iterator it;
+    if ( ASSETCHAINS_SYMBOL[0] == 0 || height <= 0 )
+        return;
+    db = komodo_kvdb();
+    portable_mutex_lock(&KOMODO_KV_mutex);
+    if ( KOMODO_INITDONE == 0 && height <= KOMODO_KVDB_LOADED ) // komodostate replay of a reorg the kvstore already went through
+    {
+        portable_mutex_unlock(&KOMODO_KV_mutex);
+        return;
+    }
+    {
+        boost::scoped_ptr<leveldb::Iterator> pcursor(komodo_kvdb_seek(db,'u',height));
+        for (; pcursor->Valid() && komodo_kvdbkey_height(pcursor->key(),'u') >= height; pcursor->Next())
+        {
+            try {
+                leveldb::Slice slValue = pcursor->value();
+                CDataStream ssValue(slValue.data(),slValue.data() + slValue.size(),SER_DISK,CLIENT_VERSION);
+                ssValue >> U;
+            } catch (const std::exception& e) {
+                fprintf(stderr,"komodo_kvrewind ht.%d undo error %s\n",height,e.what());
+                break;
+            }
+            if ( oldest.count(U.key) == 0 ) // the first change to a key above height holds its state at height-1
+                oldest[U.key] = U;
+            batch.Erase(komodo_kvdbkey_slice(pcursor->key()));
+        }
+    }
+    {
+        boost::scoped_ptr<leveldb::Iterator> pcursor(komodo_kvdb_seek(db,'a',height));
+        for (; pcursor->Valid() && komodo_kvdbkey_height(pcursor->key(),'a') >= height; pcursor->Next())
+            batch.Erase(komodo_kvdbkey_slice(pcursor->key()));
+    }
+    for (it=oldest.begin(); it!=oldest.end(); it++)
+    {
+        const std::vector<uint8_t> &key = it->first;
+        if ( db->Read(komodo_kvdbkey_make('k',-1,key.data(),(int32_t)key.size()),cur) != 0 )
+            komodo_kvdb_put(batch,key,&cur,it->second.existed != 0 ? &it->second.prev : 0);
+        else komodo_kvdb_put(batch,key,0,it->second.existed != 0 ? &it->second.prev : 0);
+    }
+    if ( KOMODO_KVDB_HEIGHT >= height )
+    {
+        KOMODO_KVDB_HEIGHT = height-1;
+        batch.Write(komodo_kvdbkey_make('h',-1,0,0),KOMODO_KVDB_HEIGHT);
+    }
+    KOMODO_KVUNDO_HEIGHT = -1;
+    db->WriteBatch(batch);
+    portable_mutex_unlock(&KOMODO_KV_mutex);
+}
+
+// flushes the kvstore and returns the height it is complete through, recorded by komodostate snapshots
+int32_t komodo_kvsync()
+{
+    CLevelDBWrapper *db; int32_t height;
+    if ( ASSETCHAINS_SYMBOL[0] == 0 )
+        return(0);
+    db = komodo_kvdb();
+    portable_mutex_lock(&KOMODO_KV_mutex);
+    height = KOMODO_KVDB_HEIGHT;
+    portable_mutex_unlock(&KOMODO_KV_mutex);
+    db->Sync();
+    return(height);
+}
+
 #endif
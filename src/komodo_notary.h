@@ -197,10 +197,57 @@ const char *Notaries_elected1[][2] =
     { "xxspot2_XX", "03d85b221ea72ebcd25373e7961f4983d12add66a92f899deaf07bab1d8b6f5573" }
 };
 
+// notary sets are published per era as immutable snapshots, so lookups never take komodo_mutex.
+// a superseded snapshot may still be in use by a reader and is never freed, elections are rare
+struct knotaries_snapshot *komodo_notaryset_create(uint8_t pubkeys[64][33],int32_t num)
+{
+    struct knotaries_snapshot *np; int32_t i,j; uint8_t tmp;
+    if ( num <= 0 || num > 64 )
+        return(0);
+    np = (struct knotaries_snapshot *)calloc(1,sizeof(*np));
+    np->numnotaries = num;
+    memcpy(np->pubkeys,pubkeys,num * 33);
+    for (i=0; i<num; i++)
+    {
+        np->sorted[i] = i;
+        for (j=i; j>0 && memcmp(np->pubkeys[np->sorted[j-1]],np->pubkeys[np->sorted[j]],33) > 0; j--)
+            tmp = np->sorted[j], np->sorted[j] = np->sorted[j-1], np->sorted[j-1] = tmp;
+    }
+    return(np);
+}
+
+struct knotaries_snapshot *komodo_notaryset(int32_t htind)
+{
+    if ( Pubkeys_snapshot == 0 )
+        return(0);
+    return(__atomic_load_n(&Pubkeys_snapshot[htind],__ATOMIC_ACQUIRE));
+}
+
+void komodo_notaryset_publish(int32_t htind,struct knotaries_snapshot *np)
+{
+    __atomic_store_n(&Pubkeys_snapshot[htind],np,__ATOMIC_RELEASE);
+}
+
+int32_t komodo_notaryset_find(struct knotaries_snapshot *np,uint8_t *pubkey33)
+{
+    int32_t lo,hi,mid,cmp;
+    lo = 0, hi = np->numnotaries - 1;
+    while ( lo <= hi )
+    {
+        mid = (lo + hi) >> 1;
+        if ( (cmp= memcmp(np->pubkeys[np->sorted[mid]],pubkey33,33)) == 0 )
+            return(np->sorted[mid]);
+        else if ( cmp < 0 )
+            lo = mid + 1;
+        else hi = mid - 1;
+    }
+    return(-1);
+}
+
 int32_t komodo_notaries(uint8_t pubkeys[64][33],int32_t height,uint32_t timestamp)
 {
     static uint8_t elected_pubkeys0[64][33],elected_pubkeys1[64][33],did0,did1;
-    int32_t i,htind,n; uint64_t mask = 0; struct knotary_entry *kp,*tmp;
+    int32_t i,htind,n; struct knotaries_snapshot *np;
     if ( timestamp == 0 && ASSETCHAINS_SYMBOL[0] != 0 )
         timestamp = komodo_heightstamp(height);
     if ( height >= KOMODO_NOTARIES_HARDCODED || ASSETCHAINS_SYMBOL[0] != 0 )
@@ -241,23 +288,13 @@ int32_t komodo_notaries(uint8_t pubkeys[64][33],int32_t height,uint32_t timestam
         komodo_init(height);
         //printf("Pubkeys.%p htind.%d vs max.%d\n",Pubkeys,htind,KOMODO_MAXBLOCKS / KOMODO_ELECTION_GAP);
     }
-    pthread_mutex_lock(&komodo_mutex);
-    n = Pubkeys[htind].numnotaries;
+    if ( (np= komodo_notaryset(htind)) == 0 )
+        return(0);
+    n = np->numnotaries;
     if ( 0 && ASSETCHAINS_SYMBOL[0] != 0 )
         fprintf(stderr,"%s height.%d t.%u genesis.%d\n",ASSETCHAINS_SYMBOL,height,timestamp,n);
-    HASH_ITER(hh,Pubkeys[htind].Notaries,kp,tmp)
-    {
-        if ( kp->notaryid < n )
-        {
-            mask |= (1LL << kp->notaryid);
-            memcpy(pubkeys[kp->notaryid],kp->pubkey,33);
-        } else printf("illegal notaryid.%d vs n.%d\n",kp->notaryid,n);
-    }
-    pthread_mutex_unlock(&komodo_mutex);
-    if ( (n < 64 && mask == ((1LL << n)-1)) || (n == 64 && mask == 0xffffffffffffffffLL) )
-        return(n);
-    printf("error retrieving notaries ht.%d got mask.%llx for n.%d\n",height,(long long)mask,n);
-    return(-1);
+    memcpy(pubkeys,np->pubkeys,n * 33);
+    return(n);
 }
 
 int32_t komodo_electednotary(int32_t *numnotariesp,uint8_t *pubkey33,int32_t height,uint32_t timestamp)
@@ -291,9 +328,13 @@ int32_t komodo_ratify_threshold(int32_t height,uint64_t signedmask)
 void komodo_notarysinit(int32_t origheight,uint8_t pubkeys[64][33],int32_t num)
 {
     static int32_t hwmheight;
-    int32_t k,i,htind,height; struct knotary_entry *kp; struct knotaries_entry N;
+    int32_t k,i,htind,height; struct knotary_entry *kp; struct knotaries_entry N; struct knotaries_snapshot *np;
     if ( Pubkeys == 0 )
+    {
         Pubkeys = (struct knotaries_entry *)calloc(1 + (KOMODO_MAXBLOCKS / KOMODO_ELECTION_GAP),sizeof(*Pubkeys));
+        Pubkeys_snapshot = (struct knotaries_snapshot **)calloc(1 + (KOMODO_MAXBLOCKS / KOMODO_ELECTION_GAP),sizeof(*Pubkeys_snapshot));
+    }
+    np = komodo_notaryset_create(pubkeys,num);
     memset(&N,0,sizeof(N));
     if ( origheight > 0 )
     {
@@ -329,16 +370,26 @@ void komodo_notarysinit(int32_t origheight,uint8_t pubkeys[64][33],int32_t num)
         }
         Pubkeys[i] = N;
         Pubkeys[i].height = i * KOMODO_ELECTION_GAP;
+        komodo_notaryset_publish(i,np);
     }
+    __atomic_add_fetch(&KOMODO_NOTARYSET_GEN,1,__ATOMIC_RELEASE); // only once every era is updated, see komodo_minerwindow_mid
     pthread_mutex_unlock(&komodo_mutex);
     if ( origheight > hwmheight )
         hwmheight = origheight;
 }
 
+// for a fixed pubkey33 and timestamp, komodo_chosennotary's notaryid only changes when this does
+int32_t komodo_notaryera(int32_t height,uint32_t timestamp)
+{
+    if ( timestamp == 0 && ASSETCHAINS_SYMBOL[0] != 0 )
+        return(height); // komodo_heightstamp() differs per height
+    return((height / KOMODO_ELECTION_GAP) * 2 + (height <= KOMODO_NOTARIES_HEIGHT1));
+}
+
 int32_t komodo_chosennotary(int32_t *notaryidp,int32_t height,uint8_t *pubkey33,uint32_t timestamp)
 {
     // -1 if not notary, 0 if notary, 1 if special notary
-    struct knotary_entry *kp; int32_t numnotaries=0,htind,modval = -1;
+    struct knotaries_snapshot *np; int32_t numnotaries=0,htind,modval = -1;
     *notaryidp = -1;
     if ( height < 0 )//|| height >= KOMODO_MAXBLOCKS )
     {
@@ -360,17 +411,11 @@ int32_t komodo_chosennotary(int32_t *notaryidp,int32_t height,uint8_t *pubkey33,
     htind = height / KOMODO_ELECTION_GAP;
     if ( htind >= KOMODO_MAXBLOCKS / KOMODO_ELECTION_GAP )
         htind = (KOMODO_MAXBLOCKS / KOMODO_ELECTION_GAP) - 1;
-    pthread_mutex_lock(&komodo_mutex);
-    HASH_FIND(hh,Pubkeys[htind].Notaries,pubkey33,33,kp);
-    pthread_mutex_unlock(&komodo_mutex);
-    if ( kp != 0 )
+    if ( (np= komodo_notaryset(htind)) != 0 && (*notaryidp= komodo_notaryset_find(np,pubkey33)) >= 0 )
     {
-        if ( (numnotaries= Pubkeys[htind].numnotaries) > 0 )
-        {
-            *notaryidp = kp->notaryid;
-            modval = ((height % numnotaries) == kp->notaryid);
-            //printf("found notary.%d ht.%d modval.%d\n",kp->notaryid,height,modval);
-        } else printf("unexpected zero notaries at height.%d\n",height);
+        numnotaries = np->numnotaries;
+        modval = ((height % numnotaries) == *notaryidp);
+        //printf("found notary.%d ht.%d modval.%d\n",*notaryidp,height,modval);
     } //else printf("cant find kp at htind.%d ht.%d\n",htind,height);
     //int32_t i; for (i=0; i<33; i++)
     //    printf("%02x",pubkey33[i]);
@@ -397,23 +442,69 @@ int32_t komodo_notarized_height(uint256 *hashp,uint256 *txidp)
 }
 
 
+struct notarized_checkpoint *komodo_npptr(struct komodo_state *sp,int32_t i)
+{
+    return(&sp->NPOINTS[i >> KOMODO_NPOINTS_CHUNKBITS][i & (KOMODO_NPOINTS_CHUNKSIZE - 1)]);
+}
+
+int32_t komodo_npoints_num(struct komodo_state *sp)
+{
+    return(__atomic_load_n(&sp->NUM_NPOINTS,__ATOMIC_ACQUIRE));
+}
+
+// index of the first checkpoint whose running max (nHeight or notarized_height) is >= height
+int32_t komodo_npoints_lowerbound(struct komodo_state *sp,int32_t num,int32_t height,int32_t notarizedflag)
+{
+    int32_t lo = 0,hi = num,mid,val; struct notarized_checkpoint *np;
+    while ( lo < hi )
+    {
+        mid = lo + ((hi - lo) >> 1);
+        np = komodo_npptr(sp,mid);
+        val = (notarizedflag != 0) ? np->maxnotarized : np->maxheight;
+        if ( val < height )
+            lo = mid + 1;
+        else hi = mid;
+    }
+    return(lo);
+}
+
+struct notarized_checkpoint *komodo_npoints_MoM(struct komodo_state *sp,int32_t height)
+{
+    int32_t i,lo,hi,num; struct notarized_checkpoint *np;
+    if ( (num= komodo_npoints_num(sp)) <= 0 )
+        return(0);
+    lo = komodo_npoints_lowerbound(sp,num,height,1); // everything before lo is notarized below height
+    if ( __atomic_load_n(&sp->NPOINTS_unsorted,__ATOMIC_RELAXED) == 0 )
+        hi = komodo_npoints_lowerbound(sp,num,height + __atomic_load_n(&sp->NPOINTS_maxMoMdepth,__ATOMIC_RELAXED),1);
+    else hi = num;
+    for (i=hi-1; i>=lo; i--)
+    {
+        np = komodo_npptr(sp,i);
+        if ( np->MoMdepth > 0 && height > np->notarized_height-np->MoMdepth && height <= np->notarized_height )
+            return(np);
+    }
+    return(0);
+}
+
+struct notarized_checkpoint *komodo_npoints_notarized(struct komodo_state *sp,int32_t nHeight)
+{
+    int32_t i,num;
+    if ( (num= komodo_npoints_num(sp)) <= 0 )
+        return(0);
+    if ( (i= komodo_npoints_lowerbound(sp,num,nHeight,0)) > 0 )
+        return(komodo_npptr(sp,i-1));
+    return(0);
+}
+
 int32_t komodo_MoMdata(int32_t *notarized_htp,uint256 *MoMp,uint256 *kmdtxidp,int32_t height)
 {
-    int32_t i; char symbol[KOMODO_ASSETCHAIN_MAXLEN],dest[KOMODO_ASSETCHAIN_MAXLEN]; struct komodo_state *sp; struct notarized_checkpoint *np = 0;
-    np = 0;
-    if ( (sp= komodo_stateptr(symbol,dest)) != 0 )
+    char symbol[KOMODO_ASSETCHAIN_MAXLEN],dest[KOMODO_ASSETCHAIN_MAXLEN]; struct komodo_state *sp; struct notarized_checkpoint *np;
+    if ( (sp= komodo_stateptr(symbol,dest)) != 0 && (np= komodo_npoints_MoM(sp,height)) != 0 )
     {
-        for (i=sp->NUM_NPOINTS-1; i>=0; i--)
-        {
-            np = &sp->NPOINTS[i];
-            if ( np->MoMdepth > 0 && height > np->notarized_height-np->MoMdepth && height <= np->notarized_height )
-            {
-                *notarized_htp = np->notarized_height;
-                *MoMp = np->MoM;
-                *kmdtxidp = np->notarized_desttxid;
-                return(np->MoMdepth);
-            }
-        }
+        *notarized_htp = np->notarized_height;
+        *MoMp = np->MoM;
+        *kmdtxidp = np->notarized_desttxid;
+        return(np->MoMdepth);
     }
     *notarized_htp = 0;
     memset(MoMp,0,sizeof(*MoMp));
@@ -423,54 +514,13 @@ int32_t komodo_MoMdata(int32_t *notarized_htp,uint256 *MoMp,uint256 *kmdtxidp,in
 
 int32_t komodo_notarizeddata(int32_t nHeight,uint256 *notarized_hashp,uint256 *notarized_desttxidp)
 {
-    struct notarized_checkpoint *np = 0; int32_t i=0,flag = 0; char symbol[KOMODO_ASSETCHAIN_MAXLEN],dest[KOMODO_ASSETCHAIN_MAXLEN]; struct komodo_state *sp;
-    if ( (sp= komodo_stateptr(symbol,dest)) != 0 )
+    char symbol[KOMODO_ASSETCHAIN_MAXLEN],dest[KOMODO_ASSETCHAIN_MAXLEN]; struct komodo_state *sp; struct notarized_checkpoint *np;
+    if ( (sp= komodo_stateptr(symbol,dest)) != 0 && (np= komodo_npoints_notarized(sp,nHeight)) != 0 )
     {
-        if ( sp->NUM_NPOINTS > 0 )
-        {
-            flag = 0;
-            if ( sp->last_NPOINTSi < sp->NUM_NPOINTS && sp->last_NPOINTSi > 0 )
-            {
-                np = &sp->NPOINTS[sp->last_NPOINTSi-1];
-                if ( np->nHeight < nHeight )
-                {
-                    for (i=sp->last_NPOINTSi; i<sp->NUM_NPOINTS; i++)
-                    {
-                        if ( sp->NPOINTS[i].nHeight >= nHeight )
-                        {
-                            //printf("flag.1 i.%d np->ht %d [%d].ht %d >= nHeight.%d, last.%d num.%d\n",i,np->nHeight,i,sp->NPOINTS[i].nHeight,nHeight,sp->last_NPOINTSi,sp->NUM_NPOINTS);
-                            flag = 1;
-                            break;
-                        }
-                        np = &sp->NPOINTS[i];
-                        sp->last_NPOINTSi = i;
-                    }
-                }
-            }
-            if ( flag == 0 )
-            {
-                np = 0;
-                for (i=0; i<sp->NUM_NPOINTS; i++)
-                {
-                    if ( sp->NPOINTS[i].nHeight >= nHeight )
-                    {
-                        //printf("i.%d np->ht %d [%d].ht %d >= nHeight.%d\n",i,np->nHeight,i,sp->NPOINTS[i].nHeight,nHeight);
-                        break;
-                    }
-                    np = &sp->NPOINTS[i];
-                    sp->last_NPOINTSi = i;
-                }
-            }
-        }
-        if ( np != 0 )
-        {
-            //char str[65],str2[65]; printf("[%s] notarized_ht.%d\n",ASSETCHAINS_SYMBOL,np->notarized_height);
-            if ( np->nHeight >= nHeight || (i < sp->NUM_NPOINTS && np[1].nHeight < nHeight) )
-                printf("warning: flag.%d i.%d np->ht %d [1].ht %d >= nHeight.%d\n",flag,i,np->nHeight,np[1].nHeight,nHeight);
-            *notarized_hashp = np->notarized_hash;
-            *notarized_desttxidp = np->notarized_desttxid;
-            return(np->notarized_height);
-        }
+        //char str[65],str2[65]; printf("[%s] notarized_ht.%d\n",ASSETCHAINS_SYMBOL,np->notarized_height);
+        *notarized_hashp = np->notarized_hash;
+        *notarized_desttxidp = np->notarized_desttxid;
+        return(np->notarized_height);
     }
     memset(notarized_hashp,0,sizeof(*notarized_hashp));
     memset(notarized_desttxidp,0,sizeof(*notarized_desttxidp));
@@ -479,7 +529,7 @@ int32_t komodo_notarizeddata(int32_t nHeight,uint256 *notarized_hashp,uint256 *n
 
 void komodo_notarized_update(struct komodo_state *sp,int32_t nHeight,int32_t notarized_height,uint256 notarized_hash,uint256 notarized_desttxid,uint256 MoM,int32_t MoMdepth)
 {
-    struct notarized_checkpoint *np;
+    struct notarized_checkpoint *np,*prev = 0; int32_t num;
     if ( notarized_height >= nHeight )
     {
         fprintf(stderr,"komodo_notarized_update REJECT notarized_height %d > %d nHeight\n",notarized_height,nHeight);
@@ -488,8 +538,20 @@ void komodo_notarized_update(struct komodo_state *sp,int32_t nHeight,int32_t not
     if ( 0 && ASSETCHAINS_SYMBOL[0] != 0 )
         fprintf(stderr,"[%s] komodo_notarized_update nHeight.%d notarized_height.%d\n",ASSETCHAINS_SYMBOL,nHeight,notarized_height);
     portable_mutex_lock(&komodo_mutex);
-    sp->NPOINTS = (struct notarized_checkpoint *)realloc(sp->NPOINTS,(sp->NUM_NPOINTS+1) * sizeof(*sp->NPOINTS));
-    np = &sp->NPOINTS[sp->NUM_NPOINTS++];
+    num = sp->NUM_NPOINTS;
+    if ( (num >> KOMODO_NPOINTS_CHUNKBITS) >= KOMODO_NPOINTS_MAXCHUNKS )
+    {
+        portable_mutex_unlock(&komodo_mutex);
+        fprintf(stderr,"[%s] komodo_notarized_update overflow NPOINTS.%d\n",ASSETCHAINS_SYMBOL,num);
+        return;
+    }
+    if ( sp->NPOINTS == 0 )
+        sp->NPOINTS = (struct notarized_checkpoint **)calloc(KOMODO_NPOINTS_MAXCHUNKS,sizeof(*sp->NPOINTS));
+    if ( sp->NPOINTS[num >> KOMODO_NPOINTS_CHUNKBITS] == 0 )
+        sp->NPOINTS[num >> KOMODO_NPOINTS_CHUNKBITS] = (struct notarized_checkpoint *)calloc(KOMODO_NPOINTS_CHUNKSIZE,sizeof(**sp->NPOINTS));
+    if ( num > 0 )
+        prev = komodo_npptr(sp,num-1);
+    np = komodo_npptr(sp,num);
     memset(np,0,sizeof(*np));
     np->nHeight = nHeight;
     sp->NOTARIZED_HEIGHT = np->notarized_height = notarized_height;
@@ -497,9 +559,60 @@ void komodo_notarized_update(struct komodo_state *sp,int32_t nHeight,int32_t not
     sp->NOTARIZED_DESTTXID = np->notarized_desttxid = notarized_desttxid;
     sp->MoM = np->MoM = MoM;
     sp->MoMdepth = np->MoMdepth = MoMdepth;
+    np->maxheight = (prev != 0 && prev->maxheight > nHeight) ? prev->maxheight : nHeight;
+    np->maxnotarized = (prev != 0 && prev->maxnotarized > notarized_height) ? prev->maxnotarized : notarized_height;
+    if ( prev != 0 && notarized_height < prev->maxnotarized )
+        sp->NPOINTS_unsorted = 1; // komodo_npoints_MoM can no longer bound its scan from above
+    if ( MoMdepth > sp->NPOINTS_maxMoMdepth )
+        sp->NPOINTS_maxMoMdepth = MoMdepth;
+    __atomic_store_n(&sp->NUM_NPOINTS,num+1,__ATOMIC_RELEASE);
     portable_mutex_unlock(&komodo_mutex);
 }
 
+// the pre-index lookup, kept as the reference for komodo_notarized_benchmark
+struct notarized_checkpoint *komodo_npoints_linearscan(struct komodo_state *sp,int32_t nHeight)
+{
+    int32_t i,num; struct notarized_checkpoint *np = 0;
+    num = komodo_npoints_num(sp);
+    for (i=0; i<num; i++)
+    {
+        if ( komodo_npptr(sp,i)->nHeight >= nHeight )
+            break;
+        np = komodo_npptr(sp,i);
+    }
+    return(np);
+}
+
+double komodo_notarized_benchmark(int32_t numpoints,int32_t numlookups,int32_t linearscan)
+{
+    struct komodo_state *sp; struct notarized_checkpoint *np; int32_t i,ht,errs = 0; uint256 hash,zero; double startmillis,elapsed;
+    memset(&zero,0,sizeof(zero));
+    sp = (struct komodo_state *)calloc(1,sizeof(*sp));
+    for (i=0; i<numpoints; i++)
+    {
+        hash = zero;
+        hash.begin()[0] = i;
+        komodo_notarized_update(sp,(i+1)*10,(i+1)*10 - 5,hash,hash,hash,(i & 1) * 10);
+    }
+    startmillis = OS_milliseconds();
+    for (i=0; i<numlookups; i++)
+    {
+        ht = (int32_t)((((uint64_t)i * 2654435761U) % numpoints) * 10) + 17;
+        np = (linearscan != 0) ? komodo_npoints_linearscan(sp,ht) : komodo_npoints_notarized(sp,ht);
+        if ( np == 0 || np->nHeight >= ht )
+            errs++;
+    }
+    elapsed = (OS_milliseconds() - startmillis) / 1000.;
+    if ( errs != 0 )
+        fprintf(stderr,"komodo_notarized_benchmark linearscan.%d errs.%d\n",linearscan,errs);
+    for (i=0; i<KOMODO_NPOINTS_MAXCHUNKS && sp->NPOINTS != 0; i++)
+        if ( sp->NPOINTS[i] != 0 )
+            free(sp->NPOINTS[i]);
+    free(sp->NPOINTS);
+    free(sp);
+    return(elapsed);
+}
+
 void komodo_init(int32_t height)
 {
     static int didinit; uint256 zero; int32_t k,n; uint8_t pubkeys[64][33];
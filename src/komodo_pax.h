@@ -347,6 +347,11 @@ void komodo_pvals(int32_t height,uint32_t *pvals,uint8_t numpvals)
             BTCUSD = PAX_BTCUSD(height,btcusd);
             CNYUSD = ((double)cnyusd / 1000000000.);
             portable_mutex_lock(&komodo_mutex);
+            while ( NUM_PRICES > 0 && PVALS[36 * (NUM_PRICES-1)] >= height ) // reorged away, a newer row now answers for these heights
+            {
+                NUM_PRICES--;
+                KOMODO_PVALS_REWINDS++;
+            }
             PVALS = (uint32_t *)realloc(PVALS,(NUM_PRICES+1) * sizeof(*PVALS) * 36);
             PVALS[36 * NUM_PRICES] = height;
             memcpy(&PVALS[36 * NUM_PRICES + 1],pvals,sizeof(*pvals) * 35);
@@ -358,6 +363,42 @@ void komodo_pvals(int32_t height,uint32_t *pvals,uint8_t numpvals)
     }
 }
 
+// drops rows superseded by a later row at the same or lower height (reorgs in older snapshots), PVALS is then sorted by height
+void komodo_pvals_compact()
+{
+    int32_t i,n; uint32_t minheight = 0xffffffff;
+    for (i=n=NUM_PRICES-1; i>=0; i--)
+    {
+        if ( PVALS[36 * i] < minheight )
+        {
+            minheight = PVALS[36 * i];
+            if ( i != n )
+                memcpy(&PVALS[36 * n],&PVALS[36 * i],sizeof(*PVALS) * 36);
+            n--;
+        }
+    }
+    if ( ++n > 0 )
+    {
+        memmove(PVALS,&PVALS[36 * n],sizeof(*PVALS) * 36 * (NUM_PRICES - n));
+        NUM_PRICES -= n;
+    }
+    KOMODO_PVALS_REWINDS++;
+}
+
+// index of the last row below height, -1 if none
+int32_t komodo_pvalsfind(int32_t height)
+{
+    int32_t lo = 0,hi = NUM_PRICES,mid;
+    while ( lo < hi )
+    {
+        mid = lo + ((hi - lo) >> 1);
+        if ( (int32_t)PVALS[36 * mid] < height )
+            lo = mid + 1;
+        else hi = mid;
+    }
+    return(lo - 1);
+}
+
 uint64_t komodo_paxcorrelation(uint64_t *votes,int32_t numvotes,uint64_t seed)
 {
     int32_t i,j,k,ind,zeroes,wt,nonz; int64_t delta; uint64_t lastprice,tolerance,den,densum,sum=0;
@@ -502,22 +543,19 @@ uint64_t _komodo_paxprice(uint64_t *kmdbtcp,uint64_t *btcusdp,int32_t height,cha
     if ( (baseid= komodo_baseid(base)) >= 0 && (relid= komodo_baseid(rel)) >= 0 )
     {
         //portable_mutex_lock(&komodo_mutex);
-        for (i=NUM_PRICES-1; i>=0; i--)
+        if ( (i= komodo_pvalsfind(height)) >= 0 )
         {
             ptr = &PVALS[36 * i];
-            if ( *ptr < height )
+            pvals = &ptr[1];
+            if ( kmdbtcp != 0 && btcusdp != 0 )
             {
-                pvals = &ptr[1];
-                if ( kmdbtcp != 0 && btcusdp != 0 )
-                {
-                    *kmdbtcp = pvals[MAX_CURRENCIES] / 539;
-                    *btcusdp = pvals[MAX_CURRENCIES + 1] / 539;
-                }
-                //portable_mutex_unlock(&komodo_mutex);
-                if ( kmdbtc != 0 && btcusd != 0 )
-                    return(komodo_paxcalc(height,pvals,baseid,relid,basevolume,kmdbtc,btcusd));
-                else return(0);
+                *kmdbtcp = pvals[MAX_CURRENCIES] / 539;
+                *btcusdp = pvals[MAX_CURRENCIES + 1] / 539;
             }
+            //portable_mutex_unlock(&komodo_mutex);
+            if ( kmdbtc != 0 && btcusd != 0 )
+                return(komodo_paxcalc(height,pvals,baseid,relid,basevolume,kmdbtc,btcusd));
+            else return(0);
         }
         //portable_mutex_unlock(&komodo_mutex);
     } //else printf("paxprice invalid base.%s %d, rel.%s %d\n",base,baseid,rel,relid);
@@ -553,9 +591,60 @@ int32_t komodo_kmdbtcusd(int32_t rwflag,uint64_t *kmdbtcp,uint64_t *btcusdp,int3
     else return(-1);
 }
 
+#define KOMODO_PAXCACHE_SIZE 4096
+struct komodo_paxcache { uint64_t seed,value,value2; int32_t height,rowind,rewinds; int8_t baseid,relid; };
+struct komodo_paxcache KOMODO_PAXCACHE[KOMODO_PAXCACHE_SIZE];
+pthread_mutex_t KOMODO_PAXCACHE_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+// an entry stays valid while no PVALS row was replaced and the newest row below its window is unchanged
+int32_t komodo_paxcache(int32_t rwflag,uint64_t *valuep,uint64_t *value2p,uint64_t seed,int32_t height,int32_t baseid,int32_t relid)
+{
+    struct komodo_paxcache *ptr; int32_t rowind,retval = -1;
+    rowind = komodo_pvalsfind(height > 10 ? height - 10 : height);
+    ptr = &KOMODO_PAXCACHE[((uint32_t)height * 2654435761U ^ (uint32_t)seed ^ ((baseid + 1) << 7) ^ (relid + 1)) % KOMODO_PAXCACHE_SIZE];
+    pthread_mutex_lock(&KOMODO_PAXCACHE_mutex);
+    if ( rwflag == 0 )
+    {
+        if ( ptr->height == height && ptr->seed == seed && ptr->baseid == baseid && ptr->relid == relid && ptr->rowind == rowind && ptr->rewinds == KOMODO_PVALS_REWINDS )
+        {
+            *valuep = ptr->value;
+            *value2p = ptr->value2;
+            retval = 0;
+        }
+    }
+    else
+    {
+        ptr->seed = seed, ptr->height = height, ptr->baseid = baseid, ptr->relid = relid;
+        ptr->rowind = rowind, ptr->rewinds = KOMODO_PVALS_REWINDS;
+        ptr->value = *valuep, ptr->value2 = *value2p;
+        retval = 0;
+    }
+    pthread_mutex_unlock(&KOMODO_PAXCACHE_mutex);
+    return(retval);
+}
+
+// kmdbtc and btcusd only depend on seed and height, shared by every base/rel at that height
+void komodo_paxkmdbtcusd(uint64_t *kmdbtcp,uint64_t *btcusdp,uint64_t seed,int32_t height,char *base,char *rel)
+{
+    int32_t i,numvotes; uint64_t btcusds[sizeof(Peggy_inds)/sizeof(*Peggy_inds)],kmdbtcs[sizeof(Peggy_inds)/sizeof(*Peggy_inds)];
+    if ( komodo_paxcache(0,kmdbtcp,btcusdp,seed,height,-1,-1) == 0 )
+        return;
+    numvotes = (int32_t)(sizeof(Peggy_inds)/sizeof(*Peggy_inds));
+    memset(btcusds,0,sizeof(btcusds));
+    memset(kmdbtcs,0,sizeof(kmdbtcs));
+    for (i=0; i<numvotes; i++)
+    {
+        _komodo_paxprice(&kmdbtcs[numvotes-1-i],&btcusds[numvotes-1-i],height-i,base,rel,100000,0,0);
+        //printf("(%llu %llu) ",(long long)kmdbtcs[numvotes-1-i],(long long)btcusds[numvotes-1-i]);
+    }
+    *kmdbtcp = komodo_paxcorrelation(kmdbtcs,numvotes,seed) * 539;
+    *btcusdp = komodo_paxcorrelation(btcusds,numvotes,seed) * 539;
+    komodo_paxcache(1,kmdbtcp,btcusdp,seed,height,-1,-1);
+}
+
 uint64_t _komodo_paxpriceB(uint64_t seed,int32_t height,char *base,char *rel,uint64_t basevolume)
 {
-    int32_t i,j,k,ind,zeroes,numvotes,wt,nonz; int64_t delta; uint64_t lastprice,tolerance,den,densum,sum=0,votes[sizeof(Peggy_inds)/sizeof(*Peggy_inds)],btcusds[sizeof(Peggy_inds)/sizeof(*Peggy_inds)],kmdbtcs[sizeof(Peggy_inds)/sizeof(*Peggy_inds)],kmdbtc,btcusd;
+    int32_t i,zeroes,numvotes,nonz,baseid,relid; uint64_t corr,sum=0,votes[sizeof(Peggy_inds)/sizeof(*Peggy_inds)],kmdbtc,btcusd;
     if ( basevolume > KOMODO_PAXMAX )
     {
         printf("komodo_paxprice overflow %.8f\n",dstr(basevolume));
@@ -566,22 +655,15 @@ uint64_t _komodo_paxpriceB(uint64_t seed,int32_t height,char *base,char *rel,uin
         printf("kmd cannot be base currency\n");
         return(0);
     }
+    if ( (baseid= komodo_baseid(base)) < 0 || (relid= komodo_baseid(rel)) < 0 )
+        return(0);
+    if ( komodo_paxcache(0,&corr,&kmdbtc,seed,height,baseid,relid) == 0 )
+        return(corr * basevolume / 100000);
     numvotes = (int32_t)(sizeof(Peggy_inds)/sizeof(*Peggy_inds));
     memset(votes,0,sizeof(votes));
     //if ( komodo_kmdbtcusd(0,&kmdbtc,&btcusd,height) < 0 ) crashes when via passthru GUI use
-    {
-        memset(btcusds,0,sizeof(btcusds));
-        memset(kmdbtcs,0,sizeof(kmdbtcs));
-        for (i=0; i<numvotes; i++)
-        {
-            _komodo_paxprice(&kmdbtcs[numvotes-1-i],&btcusds[numvotes-1-i],height-i,base,rel,100000,0,0);
-            //printf("(%llu %llu) ",(long long)kmdbtcs[numvotes-1-i],(long long)btcusds[numvotes-1-i]);
-        }
-        kmdbtc = komodo_paxcorrelation(kmdbtcs,numvotes,seed) * 539;
-        btcusd = komodo_paxcorrelation(btcusds,numvotes,seed) * 539;
-        //komodo_kmdbtcusd(1,&kmdbtc,&btcusd,height);
-    }
-    for (i=nonz=0; i<numvotes; i++)
+    komodo_paxkmdbtcusd(&kmdbtc,&btcusd,seed,height,base,rel);
+    for (i=zeroes=nonz=0; i<numvotes; i++)
     {
         if ( (votes[numvotes-1-i]= _komodo_paxprice(0,0,height-i,base,rel,100000,kmdbtc,btcusd)) == 0 )
             zeroes++;
@@ -595,11 +677,9 @@ uint64_t _komodo_paxpriceB(uint64_t seed,int32_t height,char *base,char *rel,uin
     }
     //fprintf(stderr,"kmdbtc %llu btcusd %llu ",(long long)kmdbtc,(long long)btcusd);
     //fprintf(stderr,"komodo_paxprice nonz.%d of numvotes.%d seed.%llu %.8f\n",nonz,numvotes,(long long)seed,nonz!=0?dstr(1000. * (double)sum/nonz):0);
-    if ( nonz <= (numvotes >> 1) )
-    {
-        return(0);
-    }
-    return(komodo_paxcorrelation(votes,numvotes,seed) * basevolume / 100000);
+    corr = (nonz <= (numvotes >> 1)) ? 0 : komodo_paxcorrelation(votes,numvotes,seed);
+    komodo_paxcache(1,&corr,&kmdbtc,seed,height,baseid,relid);
+    return(corr * basevolume / 100000);
 }
 
 uint64_t komodo_paxpriceB(uint64_t seed,int32_t height,char *base,char *rel,uint64_t basevolume)
@@ -686,19 +766,22 @@ uint64_t komodo_paxprice(uint64_t *seedp,int32_t height,char *base,char *rel,uin
     return(sum);
 }
 
-int32_t komodo_paxprices(int32_t *heights,uint64_t *prices,int32_t max,char *base,char *rel)
+// newest first, rows below toheight (0 for the tip) down to fromheight, one row per interval blocks
+int32_t komodo_paxprices(int32_t *heights,uint64_t *prices,int32_t max,char *base,char *rel,int32_t fromheight,int32_t toheight,int32_t interval)
 {
     int32_t baseid=-1,relid=-1,i,num = 0; uint32_t *ptr;
+    if ( interval < 1 )
+        interval = 1;
     if ( (baseid= komodo_baseid(base)) >= 0 && (relid= komodo_baseid(rel)) >= 0 )
     {
-        for (i=NUM_PRICES-1; i>=0; i--)
+        for (i=(toheight > 0 ? komodo_pvalsfind(toheight) : NUM_PRICES-1); i>=0 && num<max; i=komodo_pvalsfind(heights[num-1] - ((heights[num-1] - fromheight) % interval)))
         {
             ptr = &PVALS[36 * i];
+            if ( (int32_t)*ptr < fromheight )
+                break;
             heights[num] = *ptr;
             prices[num] = komodo_paxcalc(*ptr,&ptr[1],baseid,relid,COIN,0,0);
             num++;
-            if ( num >= max )
-                return(num);
         }
     }
     return(num);
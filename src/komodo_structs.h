@@ -17,6 +17,7 @@
 
 #include "uthash.h"
 #include "utlist.h"
+#include <stddef.h>
 
 /*#ifdef _WIN32
 #define PACKED
@@ -48,14 +49,17 @@
 #define KOMODO_KVDURATION 1440
 #define KOMODO_ASSETCHAIN_MAXLEN 65
 
+#define KOMODO_NPOINTS_CHUNKBITS 12
+#define KOMODO_NPOINTS_CHUNKSIZE (1 << KOMODO_NPOINTS_CHUNKBITS)
+#define KOMODO_NPOINTS_MAXCHUNKS 1024 // 4M checkpoints per chain
+#define KOMODO_EVENTS_CHUNKSIZE (1 << 20)
+
 union _bits256 { uint8_t bytes[32]; uint16_t ushorts[16]; uint32_t uints[8]; uint64_t ulongs[4]; uint64_t txid; };
 typedef union _bits256 bits256;
 
 union _bits320 { uint8_t bytes[40]; uint16_t ushorts[20]; uint32_t uints[10]; uint64_t ulongs[5]; uint64_t txid; };
 typedef union _bits320 bits320;
 
-struct komodo_kv { UT_hash_handle hh; bits256 pubkey; uint8_t *key,*value; int32_t height; uint32_t flags; uint16_t keylen,valuesize; };
-
 struct komodo_event_notarized { uint256 blockhash,desttxid,MoM; int32_t notarizedheight,MoMdepth; char dest[16]; };
 struct komodo_event_pubkeys { uint8_t num; uint8_t pubkeys[64][33]; };
 struct komodo_event_opreturn { uint256 txid; uint64_t value; uint16_t vout,oplen; uint8_t opret[]; };
@@ -63,7 +67,7 @@ struct komodo_event_pricefeed { uint8_t num; uint32_t prices[35]; };
 
 struct komodo_event
 {
-    struct komodo_event *related;
+    struct komodo_event *prev;
     uint16_t len;
     int32_t height;
     uint8_t type,reorged;
@@ -71,32 +75,49 @@ struct komodo_event
     uint8_t space[];
 };
 
+struct komodo_eventchunk
+{
+    struct komodo_eventchunk *prev;
+    int64_t used; // 64 bits so space starts 16 byte aligned and every event in it stays aligned
+    uint8_t space[];
+};
+static_assert(offsetof(struct komodo_eventchunk,space) % alignof(struct komodo_event) == 0,"komodo_eventchunk header misaligns its events");
+
 struct pax_transaction
 {
     UT_hash_handle hh;
     uint256 txid;
     uint64_t komodoshis,fiatoshis,validated;
-    int32_t marked,height,otherheight,approved,didstats,ready;
+    int32_t marked,height,otherheight,approved,didstats,ready,pending; // pending is set while it sits in PAX_PENDING
     uint16_t vout;
     char symbol[KOMODO_ASSETCHAIN_MAXLEN],source[KOMODO_ASSETCHAIN_MAXLEN],coinaddr[64]; uint8_t rmd160[20],type,buf[35];
 };
 
 struct knotary_entry { UT_hash_handle hh; uint8_t pubkey[33],notaryid; };
 struct knotaries_entry { int32_t height,numnotaries; struct knotary_entry *Notaries; };
+struct knotaries_snapshot { int32_t numnotaries; uint8_t pubkeys[64][33],sorted[64]; }; // immutable once published
 struct notarized_checkpoint
 {
     uint256 notarized_hash,notarized_desttxid,MoM;
     int32_t nHeight,notarized_height,MoMdepth;
+    int32_t maxheight,maxnotarized; // running max of nHeight/notarized_height over [0..i], monotonic for binary search
 };
 
+struct komodo_rtslot { uint32_t seq,height,longestchain,timestamp; uint8_t pad[64 - 4*sizeof(uint32_t)]; }; // one cache line per chain, seq is odd while its writer is updating it
+struct komodo_rtsegment { struct komodo_rtslot slots[34]; }; // indexed by baseid, shared by every daemon using the same KMD datadir
+
+struct komodo_tail { FILE *fp; long pos,len,size; uint8_t *buf; char fname[512]; }; // buf holds [pos-len,pos) of fname, not yet consumed
+struct komodo_journal { FILE *fp; uint8_t *buf; long len,size; double lastsync; }; // records appended while a block connects, written out together once it is done
+
 struct komodo_state
 {
     uint256 NOTARIZED_HASH,NOTARIZED_DESTTXID,MoM;
     int32_t SAVEDHEIGHT,CURRENT_HEIGHT,NOTARIZED_HEIGHT,MoMdepth;
     uint32_t SAVEDTIMESTAMP;
     uint64_t deposited,issued,withdrawn,approved,redeemed,shorted;
-    struct notarized_checkpoint *NPOINTS; int32_t NUM_NPOINTS,last_NPOINTSi;
-    struct komodo_event **Komodo_events; int32_t Komodo_numevents;
+    struct notarized_checkpoint **NPOINTS; int32_t NUM_NPOINTS,NPOINTS_maxMoMdepth; uint8_t NPOINTS_unsorted; // NPOINTS chunks never move, NUM_NPOINTS is published last
+    struct komodo_eventchunk *Komodo_eventchunks; struct komodo_event *Komodo_lastevent; int32_t Komodo_numevents,Komodo_numchunks;
+    long SNAPSHOT_POS; int32_t SNAPSHOT_HEIGHT; // events below SNAPSHOT_POS came from komodostate.snap and are not in the arena
     uint32_t RTbufs[64][3]; uint64_t RTmask;
 };
 
@@ -69,7 +69,9 @@ bool fHavePruned = false;
 bool fPruneMode = false;
 bool fIsBareMultisigStd = true;
 bool fCheckBlockIndex = false;
+bool fParanoidBlockReads = false;
 bool fCheckpointsEnabled = true;
+bool fAssumeNotarized = false;
 bool fCoinbaseEnforcedProtectionEnabled = true;
 size_t nCoinCacheUsage = 5000 * 300;
 uint64_t nPruneTarget = 0;
@@ -1478,6 +1480,7 @@ bool AcceptToMemoryPool(CTxMemPool& pool, CValidationState &state, const CTransa
         if ( komodo_is_notarytx(tx) == 0 )
             KOMODO_ON_DEMAND++;
         pool.addUnchecked(hash, entry, !IsInitialBlockDownload());
+        komodo_kvpending_add(tx);
     }
     
     SyncWithWallets(tx, NULL);
@@ -1587,7 +1590,7 @@ bool WriteBlockToDisk(CBlock& block, CDiskBlockPos& pos, const CMessageHeader::M
     return true;
 }
 
-bool ReadBlockFromDisk(int32_t height,CBlock& block, const CDiskBlockPos& pos)
+bool ReadBlockFromDisk(int32_t height,CBlock& block, const CDiskBlockPos& pos,bool fCheckPOW)
 {
     uint8_t pubkey33[33];
     block.SetNull();
@@ -1608,7 +1611,9 @@ bool ReadBlockFromDisk(int32_t height,CBlock& block, const CDiskBlockPos& pos)
         fprintf(stderr,"readblockfromdisk err B\n");
         return error("%s: Deserialize or I/O error - %s at %s", __func__, e.what(), pos.ToString());
     }
-    // Check the header
+    // Check the header, unless the caller already knows it was validated before it was written
+    if ( fCheckPOW == 0 )
+        return true;
     komodo_block2pubkey33(pubkey33,block);
     if (!(CheckEquihashSolution(&block, Params()) && CheckProofOfWork(height,pubkey33,block.GetHash(), block.nBits, Params().GetConsensus())))
     {
@@ -1625,7 +1630,9 @@ bool ReadBlockFromDisk(CBlock& block, const CBlockIndex* pindex)
 {
     if ( pindex == 0 )
         return false;
-    if (!ReadBlockFromDisk(pindex->nHeight,block, pindex->GetBlockPos()))
+    // blocks are only written after CheckBlock passed, so once the index has reached
+    // BLOCK_VALID_TRANSACTIONS the hash comparison below is enough to detect a bad read
+    if (!ReadBlockFromDisk(pindex->nHeight,block, pindex->GetBlockPos(),fParanoidBlockReads || !pindex->IsValid(BLOCK_VALID_TRANSACTIONS)))
         return false;
     if (block.GetHash() != pindex->GetBlockHash())
         return error("ReadBlockFromDisk(CBlock&, CBlockIndex*): GetHash() doesn't match index for %s at %s",
@@ -1912,6 +1919,7 @@ void UpdateCoins(const CTransaction& tx, CCoinsViewCache& inputs, CTxUndo &txund
                 undo.nHeight = coins->nHeight;
                 undo.fCoinBase = coins->fCoinBase;
                 undo.nVersion = coins->nVersion;
+                undo.nLockTime = coins->nLockTime;
             }
         }
     }
@@ -1990,8 +1998,8 @@ bool CheckTxInputs(const CTransaction& tx, CValidationState& state, const CCoins
             {
                 if ( coins->vout[prevout.n].nValue >= 10*COIN )
                 {
-                    int64_t interest; int32_t txheight; uint32_t locktime;
-                    if ( (interest= komodo_accrued_interest(&txheight,&locktime,prevout.hash,prevout.n,0,coins->vout[prevout.n].nValue,(int32_t)nSpendHeight-1)) != 0 )
+                    int64_t interest;
+                    if ( (interest= komodo_coins_interest(coins->nHeight,coins->nLockTime,coins->vout[prevout.n].nValue,(int32_t)nSpendHeight-1)) != 0 )
                     {
 //fprintf(stderr,"checkResult %.8f += val %.8f interest %.8f ht.%d lock.%u tip.%u\n",(double)nValueIn/COIN,(double)coins->vout[prevout.n].nValue/COIN,(double)interest/COIN,txheight,locktime,chainActive.Tip()->nTime);
                         nValueIn += interest;
@@ -2138,6 +2146,12 @@ bool ContextualCheckInputs(
 
 namespace {
 
+/** Stream version undo data of pindex was written with, nLockTime is only present from COINS_LOCKTIME_VERSION onwards */
+int UndoVersion(const CBlockIndex* pindex)
+{
+    return (pindex->nStatus & BLOCK_UNDO_LOCKTIME) ? CLIENT_VERSION : COINS_LOCKTIME_VERSION - 1;
+}
+
 bool UndoWriteToDisk(const CBlockUndo& blockundo, CDiskBlockPos& pos, const uint256& hashBlock, const CMessageHeader::MessageStartChars& messageStart)
 {
     // Open history file to append
@@ -2156,8 +2170,8 @@ bool UndoWriteToDisk(const CBlockUndo& blockundo, CDiskBlockPos& pos, const uint
     pos.nPos = (unsigned int)fileOutPos;
     fileout << blockundo;
 
-    // calculate & write checksum
-    CHashWriter hasher(SER_GETHASH, PROTOCOL_VERSION);
+    // calculate & write checksum, over the same fields as were written
+    CHashWriter hasher(SER_GETHASH, CLIENT_VERSION);
     hasher << hashBlock;
     hasher << blockundo;
     fileout << hasher.GetHash();
@@ -2165,10 +2179,10 @@ bool UndoWriteToDisk(const CBlockUndo& blockundo, CDiskBlockPos& pos, const uint
     return true;
 }
 
-bool UndoReadFromDisk(CBlockUndo& blockundo, const CDiskBlockPos& pos, const uint256& hashBlock)
+bool UndoReadFromDisk(CBlockUndo& blockundo, const CDiskBlockPos& pos, const uint256& hashBlock, int nVersion)
 {
     // Open history file to read
-    CAutoFile filein(OpenUndoFile(pos, true), SER_DISK, CLIENT_VERSION);
+    CAutoFile filein(OpenUndoFile(pos, true), SER_DISK, nVersion);
     if (filein.IsNull())
         return error("%s: OpenBlockFile failed", __func__);
 
@@ -2183,7 +2197,7 @@ bool UndoReadFromDisk(CBlockUndo& blockundo, const CDiskBlockPos& pos, const uin
     }
 
     // Verify checksum
-    CHashWriter hasher(SER_GETHASH, PROTOCOL_VERSION);
+    CHashWriter hasher(SER_GETHASH, nVersion);
     hasher << hashBlock;
     hasher << blockundo;
     if (hashChecksum != hasher.GetHash())
@@ -2219,7 +2233,7 @@ bool AbortNode(CValidationState& state, const std::string& strMessage, const std
  * @param out The out point that corresponds to the tx input.
  * @return True on success.
  */
-static bool ApplyTxInUndo(const CTxInUndo& undo, CCoinsViewCache& view, const COutPoint& out)
+static bool ApplyTxInUndo(const CTxInUndo& undo, CCoinsViewCache& view, const COutPoint& out, int nUndoVersion)
 {
     bool fClean = true;
 
@@ -2232,6 +2246,10 @@ static bool ApplyTxInUndo(const CTxInUndo& undo, CCoinsViewCache& view, const CO
         coins->fCoinBase = undo.fCoinBase;
         coins->nHeight = undo.nHeight;
         coins->nVersion = undo.nVersion;
+        coins->nLockTime = undo.nLockTime;
+        // undo data predates nLockTime in CCoins, recover it from the transaction itself
+        if (nUndoVersion < COINS_LOCKTIME_VERSION && komodo_txlocktime(&coins->nLockTime, out.hash, undo.nHeight) < 0)
+            fClean = fClean && error("%s: cannot find locktime of %s", __func__, out.hash.ToString());
     } else {
         if (coins->IsPruned())
             fClean = fClean && error("%s: undo data adding output to missing transaction", __func__);
@@ -2258,7 +2276,7 @@ bool DisconnectBlock(CBlock& block, CValidationState& state, CBlockIndex* pindex
     CDiskBlockPos pos = pindex->GetUndoPos();
     if (pos.IsNull())
         return error("DisconnectBlock(): no undo data available");
-    if (!UndoReadFromDisk(blockUndo, pos, pindex->pprev->GetBlockHash()))
+    if (!UndoReadFromDisk(blockUndo, pos, pindex->pprev->GetBlockHash(), UndoVersion(pindex)))
         return error("DisconnectBlock(): failure reading undo data");
 
     if (blockUndo.vtxundo.size() + 1 != block.vtx.size())
@@ -2303,7 +2321,7 @@ bool DisconnectBlock(CBlock& block, CValidationState& state, CBlockIndex* pindex
             for (unsigned int j = tx.vin.size(); j-- > 0;) {
                 const COutPoint &out = tx.vin[j].prevout;
                 const CTxInUndo &undo = txundo.vprevout[j];
-                if (!ApplyTxInUndo(undo, view, out))
+                if (!ApplyTxInUndo(undo, view, out, UndoVersion(pindex)))
                     fClean = false;
             }
         }
@@ -2436,6 +2454,16 @@ bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pin
             fExpensiveChecks = false;
         }
     }
+    if (fExpensiveChecks && fAssumeNotarized) {
+        uint256 notarizedhash, notarizeddesttxid;
+        if (komodo_notarized_height(&notarizedhash, &notarizeddesttxid) > pindex->nHeight) {
+            BlockMap::iterator mi = mapBlockIndex.find(notarizedhash);
+            if (mi != mapBlockIndex.end() && mi->second->GetAncestor(pindex->nHeight) == pindex) {
+                // This block is an ancestor of a notarized block, which cannot be reorged: disable script checks
+                fExpensiveChecks = false;
+            }
+        }
+    }
     auto verifier = libzcash::ProofVerifier::Strict();
     auto disabledVerifier = libzcash::ProofVerifier::Disabled();
 
@@ -2616,7 +2644,7 @@ bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pin
 
             // update nUndoPos in block index
             pindex->nUndoPos = pos.nPos;
-            pindex->nStatus |= BLOCK_HAVE_UNDO;
+            pindex->nStatus |= BLOCK_HAVE_UNDO | BLOCK_UNDO_LOCKTIME;
         }
 
         // Now that all consensus rules have been validated, set nCachedBranchId.
@@ -2653,7 +2681,7 @@ bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pin
     LogPrint("bench", "    - Callbacks: %.2fms [%.2fs]\n", 0.001 * (nTime4 - nTime3), nTimeCallbacks * 0.000001);
     
     //FlushStateToDisk();
-    komodo_connectblock(pindex,*(CBlock *)&block);
+    komodo_connectblock(pindex,*(CBlock *)&block,&blockundo);
     return true;
 }
 
@@ -2860,6 +2888,7 @@ bool static DisconnectTip(CValidationState &state, bool fBare = false) {
     }
 
     // Update chainActive and related variables.
+    komodo_minerwindow_disconnect(pindexDelete);
     UpdateTip(pindexDelete->pprev);
     // Get the current commitment tree
     ZCIncrementalMerkleTree newTree;
@@ -2934,6 +2963,7 @@ bool static ConnectTip(CValidationState &state, CBlockIndex *pindexNew, CBlock *
 
     // Update chainActive & related variables.
     UpdateTip(pindexNew);
+    komodo_minerwindow_connect(pindexNew);
     // Tell wallet about transactions that went from mempool
     // to conflicted:
     BOOST_FOREACH(const CTransaction &tx, txConflicted) {
@@ -3793,6 +3823,8 @@ bool AcceptBlock(CBlock& block, CValidationState& state, CBlockIndex** ppindex,
         if (dbp == NULL)
             if (!WriteBlockToDisk(block, blockPos, chainparams.MessageStart()))
                 AbortNode(state, "Failed to write block");
+        uint8_t pubkey33[33];
+        komodo_blockindex_pubkey33(pubkey33, pindex, block);
         if (!ReceivedBlockTransactions(block, state, pindex, blockPos))
             return error("AcceptBlock(): ReceivedBlockTransactions failed");
     } catch (const std::runtime_error& e) {
@@ -3915,7 +3947,7 @@ void PruneOneBlockFile(const int fileNumber)
         CBlockIndex* pindex = it->second;
         if (pindex->nFile == fileNumber) {
             pindex->nStatus &= ~BLOCK_HAVE_DATA;
-            pindex->nStatus &= ~BLOCK_HAVE_UNDO;
+            pindex->nStatus &= ~(BLOCK_HAVE_UNDO | BLOCK_UNDO_LOCKTIME);
             pindex->nFile = 0;
             pindex->nDataPos = 0;
             pindex->nUndoPos = 0;
@@ -4262,7 +4294,7 @@ bool CVerifyDB::VerifyDB(CCoinsView *coinsview, int nCheckLevel, int nCheckDepth
             CBlockUndo undo;
             CDiskBlockPos pos = pindex->GetUndoPos();
             if (!pos.IsNull()) {
-                if (!UndoReadFromDisk(undo, pos, pindex->pprev->GetBlockHash()))
+                if (!UndoReadFromDisk(undo, pos, pindex->pprev->GetBlockHash(), UndoVersion(pindex)))
                     return error("VerifyDB(): *** found bad undo data at %d, hash=%s\n", pindex->nHeight, pindex->GetBlockHash().ToString());
             }
         }
@@ -4391,7 +4423,7 @@ bool RewindBlockIndex(const CChainParams& params)
                 std::min<unsigned int>(pindexIter->nStatus & BLOCK_VALID_MASK, BLOCK_VALID_TREE) |
                 (pindexIter->nStatus & ~BLOCK_VALID_MASK);
             // Remove have-data flags
-            pindexIter->nStatus &= ~(BLOCK_HAVE_DATA | BLOCK_HAVE_UNDO);
+            pindexIter->nStatus &= ~(BLOCK_HAVE_DATA | BLOCK_HAVE_UNDO | BLOCK_UNDO_LOCKTIME);
             // Remove branch ID
             pindexIter->nStatus &= ~BLOCK_ACTIVATES_UPGRADE;
             pindexIter->nCachedBranchId = boost::none;
@@ -4601,7 +4633,7 @@ bool LoadExternalBlockFile(FILE* fileIn, CDiskBlockPos *dbp)
                     std::pair<std::multimap<uint256, CDiskBlockPos>::iterator, std::multimap<uint256, CDiskBlockPos>::iterator> range = mapBlocksUnknownParent.equal_range(head);
                     while (range.first != range.second) {
                         std::multimap<uint256, CDiskBlockPos>::iterator it = range.first;
-                        if (ReadBlockFromDisk(mapBlockIndex[hash]!=0?mapBlockIndex[hash]->nHeight:0,block, it->second))
+                        if (ReadBlockFromDisk(mapBlockIndex[hash]!=0?mapBlockIndex[hash]->nHeight:0,block, it->second,true))
                         {
                             LogPrintf("%s: Processing out of order child %s of %s\n", __func__, block.GetHash().ToString(),
                                     head.ToString());
@@ -132,7 +132,11 @@ extern int nScriptCheckThreads;
 extern bool fTxIndex;
 extern bool fIsBareMultisigStd;
 extern bool fCheckBlockIndex;
+/** Re-verify Equihash and PoW of every block read from disk, even when the index marks it validated */
+extern bool fParanoidBlockReads;
 extern bool fCheckpointsEnabled;
+/** Treat ancestors of the last dPoW notarized block like ancestors of a checkpoint */
+extern bool fAssumeNotarized;
 // TODO: remove this flag by structuring our code such that
 // it is unneeded for testing
 extern bool fCoinbaseEnforcedProtectionEnabled;
@@ -19,6 +19,8 @@
 
 #include <univalue.h>
 
+#include <boost/assign/list_of.hpp>
+
 #include <regex>
 
 using namespace std;
@@ -547,19 +549,22 @@ extern char ASSETCHAINS_SYMBOL[KOMODO_ASSETCHAIN_MAXLEN];
 uint64_t komodo_interest(int32_t txheight,uint64_t nValue,uint32_t nLockTime,uint32_t tiptime);
 uint32_t komodo_txtime(uint256 hash);
 uint64_t komodo_paxprice(uint64_t *seedp,int32_t height,char *base,char *rel,uint64_t basevolume);
-int32_t komodo_paxprices(int32_t *heights,uint64_t *prices,int32_t max,char *base,char *rel);
+int32_t komodo_paxprices(int32_t *heights,uint64_t *prices,int32_t max,char *base,char *rel,int32_t fromheight,int32_t toheight,int32_t interval);
 int32_t komodo_notaries(uint8_t pubkeys[64][33],int32_t height,uint32_t timestamp);
 char *bitcoin_address(char *coinaddr,uint8_t addrtype,uint8_t *pubkey_or_rmd160,int32_t len);
 //uint32_t komodo_interest_args(int32_t *txheightp,uint32_t *tiptimep,uint64_t *valuep,uint256 hash,int32_t n);
 int32_t komodo_minerids(uint8_t *minerids,int32_t height,int32_t width);
 int32_t komodo_kvsearch(uint256 *refpubkeyp,int32_t current_height,uint32_t *flagsp,int32_t *heightp,uint8_t value[IGUANA_MAXSCRIPTSIZE],uint8_t *key,int32_t keylen);
 int32_t komodo_MoM(int32_t *notarized_htp,uint256 *MoMp,uint256 *kmdtxidp,int32_t nHeight);
+int32_t komodo_kvpending_search(uint256 *txidp,uint256 *pubkeyp,int32_t *heightp,uint32_t *flagsp,uint8_t value[IGUANA_MAXSCRIPTSIZE],uint8_t *key,int32_t keylen);
+int32_t komodo_kvprefixend(uint8_t *end,uint8_t *prefix,int32_t prefixlen);
+int32_t komodo_kvscan(int32_t current_height,uint8_t *from,int32_t fromlen,uint8_t *to,int32_t tolen,int32_t limit,int32_t (*func)(void *arg,uint8_t *key,int32_t keylen,uint256 pubkey,int32_t height,uint32_t flags,uint8_t *value,int32_t valuesize),void *arg);
 
 UniValue kvsearch(const UniValue& params, bool fHelp)
 {
-    UniValue ret(UniValue::VOBJ); uint32_t flags; uint8_t value[IGUANA_MAXSCRIPTSIZE],key[IGUANA_MAXSCRIPTSIZE]; int32_t duration,j,height,valuesize,keylen; uint256 refpubkey; static uint256 zeroes;
-    if (fHelp || params.size() != 1 )
-        throw runtime_error("kvsearch key");
+    UniValue ret(UniValue::VOBJ); uint32_t flags; uint8_t value[IGUANA_MAXSCRIPTSIZE],key[IGUANA_MAXSCRIPTSIZE]; int32_t duration,j,height,valuesize,pendingsize = -1,keylen; uint256 refpubkey,txid; static uint256 zeroes;
+    if (fHelp || params.size() < 1 || params.size() > 2 )
+        throw runtime_error("kvsearch key ( includemempool )");
     LOCK(cs_main);
     if ( (keylen= (int32_t)strlen(params[0].get_str().c_str())) > 0 )
     {
@@ -570,6 +575,18 @@ UniValue kvsearch(const UniValue& params, bool fHelp)
         if ( keylen < sizeof(key) )
         {
             memcpy(key,params[0].get_str().c_str(),keylen);
+            if ( params.size() > 1 && params[1].get_bool() && (pendingsize= komodo_kvpending_search(&txid,&refpubkey,&height,&flags,value,key,keylen)) >= 0 )
+            {
+                UniValue pending(UniValue::VOBJ);
+                pending.push_back(Pair("txid",txid.GetHex()));
+                if ( memcmp(&zeroes,&refpubkey,sizeof(refpubkey)) != 0 )
+                    pending.push_back(Pair("owner",refpubkey.GetHex()));
+                pending.push_back(Pair("height",height));
+                pending.push_back(Pair("flags",(int64_t)flags));
+                pending.push_back(Pair("value",std::string((char *)value,pendingsize)));
+                pending.push_back(Pair("valuesize",pendingsize));
+                ret.push_back(Pair("pending",pending));
+            }
             if ( (valuesize= komodo_kvsearch(&refpubkey,chainActive.Tip()->nHeight,&flags,&height,value,key,keylen)) >= 0 )
             {
                 std::string val; char *valuestr;
@@ -584,12 +601,106 @@ UniValue kvsearch(const UniValue& params, bool fHelp)
                 ret.push_back(Pair("flags",(int64_t)flags));
                 ret.push_back(Pair("value",val));
                 ret.push_back(Pair("valuesize",valuesize));
-            } else ret.push_back(Pair("error",(char *)"cant find key"));
+            } else if ( pendingsize < 0 )
+                ret.push_back(Pair("error",(char *)"cant find key"));
         } else ret.push_back(Pair("error",(char *)"key too big"));
     } else ret.push_back(Pair("error",(char *)"null key"));
     return ret;
 }
 
+#define KOMODO_KVSCAN_DEFAULTLIMIT 100
+#define KOMODO_KVSCAN_MAXLIMIT 1000
+
+struct kvscan_state { UniValue *items; std::string lastkey; };
+
+int32_t kvscan_item(void *arg,uint8_t *key,int32_t keylen,uint256 pubkey,int32_t height,uint32_t flags,uint8_t *value,int32_t valuesize)
+{
+    static uint256 zeroes; struct kvscan_state *state = (struct kvscan_state *)arg; UniValue item(UniValue::VOBJ);
+    state->lastkey.assign((char *)key,keylen);
+    item.push_back(Pair("key",state->lastkey));
+    if ( memcmp(&zeroes,&pubkey,sizeof(pubkey)) != 0 )
+        item.push_back(Pair("owner",pubkey.GetHex()));
+    item.push_back(Pair("height",height));
+    item.push_back(Pair("expiration", (int64_t)(height + ((flags >> 2) + 1) * KOMODO_KVDURATION)));
+    item.push_back(Pair("flags",(int64_t)flags));
+    item.push_back(Pair("value",std::string((char *)value,valuesize)));
+    item.push_back(Pair("valuesize",valuesize));
+    state->items->push_back(item);
+    return(0);
+}
+
+// pages through from <= key < to, at most limit live keys per call. "next" is set when the page filled up
+// and is passed back as cursor to continue right after the last key returned
+UniValue kvscan_page(std::string from,std::string to,bool fHasEnd,const UniValue& params,int32_t limitind)
+{
+    UniValue ret(UniValue::VOBJ),items(UniValue::VARR); struct kvscan_state state; int32_t n,height,limit = KOMODO_KVSCAN_DEFAULTLIMIT; std::vector<unsigned char> cursor;
+    if ( params.size() > limitind )
+    {
+        if ( (limit= params[limitind].get_int()) <= 0 || limit > KOMODO_KVSCAN_MAXLIMIT )
+            throw JSONRPCError(RPC_INVALID_PARAMETER, strprintf("limit must be between 1 and %d", KOMODO_KVSCAN_MAXLIMIT));
+    }
+    if ( params.size() > limitind+1 && params[limitind+1].get_str().size() > 0 )
+    {
+        if ( !IsHex(params[limitind+1].get_str()) )
+            throw JSONRPCError(RPC_INVALID_PARAMETER, "cursor must be hex");
+        cursor = ParseHex(params[limitind+1].get_str());
+        cursor.push_back(0); // smallest key after the cursor
+        if ( std::string(cursor.begin(),cursor.end()) > from )
+            from.assign(cursor.begin(),cursor.end());
+    }
+    {
+        LOCK(cs_main);
+        height = chainActive.Tip()->nHeight;
+    }
+    state.items = &items;
+    n = komodo_kvscan(height,(uint8_t *)from.data(),(int32_t)from.size(),fHasEnd ? (uint8_t *)to.data() : 0,(int32_t)to.size(),limit,kvscan_item,&state);
+    ret.push_back(Pair("coin",(char *)(ASSETCHAINS_SYMBOL[0] == 0 ? "KMD" : ASSETCHAINS_SYMBOL)));
+    ret.push_back(Pair("currentheight", (int64_t)height));
+    ret.push_back(Pair("count",n));
+    ret.push_back(Pair("keys",items));
+    if ( n == limit )
+        ret.push_back(Pair("next",HexStr(state.lastkey.begin(),state.lastkey.end())));
+    return ret;
+}
+
+UniValue kvscan(const UniValue& params, bool fHelp)
+{
+    std::string prefix,end; int32_t endlen;
+    if ( fHelp || params.size() < 1 || params.size() > 3 )
+        throw runtime_error(
+            "kvscan \"prefix\" ( limit \"cursor\" )\n"
+            "\nList live KV entries whose key starts with prefix, in key order.\n"
+            "\nArguments:\n"
+            "1. \"prefix\"    (string, required) key prefix, \"\" for all keys\n"
+            "2. limit         (numeric, optional, default=100) most entries to return, at most 1000\n"
+            "3. \"cursor\"    (string, optional) \"next\" from the previous page\n"
+            "\nExamples:\n"
+            + HelpExampleCli("kvscan", "\"app.users.\" 50")
+        );
+    prefix = params[0].get_str();
+    end.resize(prefix.size());
+    if ( (endlen= komodo_kvprefixend((uint8_t *)&end[0],(uint8_t *)prefix.data(),(int32_t)prefix.size())) >= 0 )
+        end.resize(endlen);
+    return(kvscan_page(prefix,end,endlen >= 0,params,1));
+}
+
+UniValue kvrange(const UniValue& params, bool fHelp)
+{
+    if ( fHelp || params.size() < 2 || params.size() > 4 )
+        throw runtime_error(
+            "kvrange \"from\" \"to\" ( limit \"cursor\" )\n"
+            "\nList live KV entries with from <= key < to, in key order.\n"
+            "\nArguments:\n"
+            "1. \"from\"      (string, required) first key of the range\n"
+            "2. \"to\"        (string, required) end of the range (exclusive), \"\" for no upper bound\n"
+            "3. limit         (numeric, optional, default=100) most entries to return, at most 1000\n"
+            "4. \"cursor\"    (string, optional) \"next\" from the previous page\n"
+            "\nExamples:\n"
+            + HelpExampleCli("kvrange", "\"a\" \"n\" 50")
+        );
+    return(kvscan_page(params[0].get_str(),params[1].get_str(),params[1].get_str().size() > 0,params,2));
+}
+
 UniValue height_MoM(const UniValue& params, bool fHelp)
 {
     int32_t height,depth,notarized_height; uint256 MoM,kmdtxid; uint32_t timestamp = 0; UniValue ret(UniValue::VOBJ); UniValue a(UniValue::VARR);
@@ -899,22 +1010,36 @@ UniValue paxprice(const UniValue& params, bool fHelp)
     return ret;
 }
 
+// komodo-cli converts some of the numeric paxprices arguments, raw JSON-RPC callers may send any of them as strings
+static int32_t paxprices_intparam(const UniValue& param)
+{
+    if ( param.isNum() )
+        return(param.get_int());
+    return(atoi(param.get_str().c_str()));
+}
+
 UniValue paxprices(const UniValue& params, bool fHelp)
 {
-    if ( fHelp || params.size() != 3 )
-        throw runtime_error("paxprices \"base\" \"rel\" maxsamples\n");
+    if ( fHelp || params.size() < 3 || params.size() > 6 )
+        throw runtime_error("paxprices \"base\" \"rel\" maxsamples ( fromheight toheight interval )\n");
     LOCK(cs_main);
-    UniValue ret(UniValue::VOBJ); uint64_t relvolume,prices[4096]; uint32_t i,n; int32_t heights[sizeof(prices)/sizeof(*prices)];
+    UniValue ret(UniValue::VOBJ); uint64_t relvolume,prices[4096]; uint32_t i,n; int32_t fromheight=0,toheight=0,interval=1,heights[sizeof(prices)/sizeof(*prices)];
     std::string base = params[0].get_str();
     std::string rel = params[1].get_str();
-    int32_t maxsamples = atoi(params[2].get_str().c_str());
+    int32_t maxsamples = paxprices_intparam(params[2]);
+    if ( params.size() > 3 )
+        fromheight = paxprices_intparam(params[3]);
+    if ( params.size() > 4 )
+        toheight = paxprices_intparam(params[4]);
+    if ( params.size() > 5 )
+        interval = paxprices_intparam(params[5]);
     if ( maxsamples < 1 )
         maxsamples = 1;
     else if ( maxsamples > sizeof(heights)/sizeof(*heights) )
         maxsamples = sizeof(heights)/sizeof(*heights);
     ret.push_back(Pair("base", base));
     ret.push_back(Pair("rel", rel));
-    n = komodo_paxprices(heights,prices,maxsamples,(char *)base.c_str(),(char *)rel.c_str());
+    n = komodo_paxprices(heights,prices,maxsamples,(char *)base.c_str(),(char *)rel.c_str(),fromheight,toheight,interval);
     UniValue a(UniValue::VARR);
     for (i=0; i<n; i++)
     {
@@ -934,7 +1059,7 @@ UniValue paxprices(const UniValue& params, bool fHelp)
     return ret;
 }
 
-uint64_t komodo_accrued_interest(int32_t *txheightp,uint32_t *locktimep,uint256 hash,int32_t n,int32_t checkheight,uint64_t checkvalue,int32_t tipheight);
+uint64_t komodo_coins_interest(int32_t txheight,uint32_t locktime,uint64_t value,int32_t tipheight);
 
 UniValue gettxout(const UniValue& params, bool fHelp)
 {
@@ -1006,8 +1131,8 @@ UniValue gettxout(const UniValue& params, bool fHelp)
         ret.push_back(Pair("confirmations", 0));
     else ret.push_back(Pair("confirmations", pindex->nHeight - coins.nHeight + 1));
     ret.push_back(Pair("value", ValueFromAmount(coins.vout[n].nValue)));
-    uint64_t interest; int32_t txheight; uint32_t locktime;
-    if ( (interest= komodo_accrued_interest(&txheight,&locktime,hash,n,coins.nHeight,coins.vout[n].nValue,(int32_t)pindex->nHeight)) != 0 )
+    uint64_t interest;
+    if ( (interest= komodo_coins_interest(coins.nHeight,coins.nLockTime,coins.vout[n].nValue,(int32_t)pindex->nHeight)) != 0 )
         ret.push_back(Pair("interest", ValueFromAmount(interest)));
     UniValue o(UniValue::VOBJ);
     ScriptPubKeyToJSON(coins.vout[n].scriptPubKey, o, true);
@@ -1018,6 +1143,103 @@ UniValue gettxout(const UniValue& params, bool fHelp)
     return ret;
 }
 
+void komodo_interest_batch(uint64_t *interests,const uint64_t *values,const uint32_t *locktimes,const int32_t *txheights,int32_t n,uint32_t tiptime);
+
+UniValue calcinterest(const UniValue& params, bool fHelp)
+{
+    if (fHelp || params.size() != 1)
+        throw runtime_error(
+            "calcinterest [{\"txid\":\"id\",\"vout\":n},...]\n"
+            "\nReturns the interest accrued so far by a list of unspent outputs, as gettxout would report it.\n"
+            "\nArguments:\n"
+            "1. \"outputs\"    (string, required) A json array of json objects\n"
+            "     [\n"
+            "       {\n"
+            "         \"txid\":\"id\",  (string, required) The transaction id\n"
+            "         \"vout\":n        (numeric, required) The output number\n"
+            "       }\n"
+            "       ,...\n"
+            "     ]\n"
+            "\nResult:\n"
+            "{\n"
+            "  \"bestblock\" : \"hash\",    (string) the block hash\n"
+            "  \"tiptime\" : n,            (numeric) the block time interest is computed at\n"
+            "  \"outputs\" : [\n"
+            "    {\n"
+            "      \"txid\" : \"id\",        (string) The transaction id\n"
+            "      \"vout\" : n,           (numeric) The output number\n"
+            "      \"unspent\" : true|false, (boolean) Whether the output is in the utxo set, if not it is skipped\n"
+            "      \"value\" : x.xxx,      (numeric) The output value in " + CURRENCY_UNIT + "\n"
+            "      \"interest\" : x.xxx    (numeric) The accrued interest in " + CURRENCY_UNIT + "\n"
+            "    }\n"
+            "    ,...\n"
+            "  ],\n"
+            "  \"total\" : x.xxx          (numeric) The sum of interest over all unspent outputs\n"
+            "}\n"
+
+            "\nExamples:\n"
+            + HelpExampleCli("calcinterest", "\"[{\\\"txid\\\":\\\"myid\\\",\\\"vout\\\":0}]\"") +
+            "\nAs a json rpc call\n"
+            + HelpExampleRpc("calcinterest", "[{\"txid\":\"myid\",\"vout\":0}]")
+        );
+
+    RPCTypeCheck(params, boost::assign::list_of(UniValue::VARR));
+    UniValue outputs = params[0].get_array();
+
+    LOCK(cs_main);
+
+    BlockMap::iterator it = mapBlockIndex.find(pcoinsTip->GetBestBlock());
+    CBlockIndex *pindex = it->second;
+    std::vector<uint64_t> values, interests;
+    std::vector<uint32_t> locktimes;
+    std::vector<int32_t> txheights;
+    std::vector<int> found;
+    for (size_t i = 0; i < outputs.size(); i++) {
+        const UniValue& output = outputs[i].get_obj();
+        uint256 txid = ParseHashO(output, "txid");
+        const UniValue& vout_v = find_value(output, "vout");
+        if (!vout_v.isNum())
+            throw JSONRPCError(RPC_INVALID_PARAMETER, "Invalid parameter, missing vout key");
+        int n = vout_v.get_int();
+        CCoins coins;
+        if (n < 0 || !pcoinsTip->GetCoins(txid, coins) || !coins.IsAvailable(n)) {
+            found.push_back(-1);
+            continue;
+        }
+        found.push_back(values.size());
+        values.push_back(coins.vout[n].nValue);
+        locktimes.push_back(coins.nLockTime);
+        txheights.push_back(coins.nHeight);
+    }
+    interests.resize(values.size());
+    if (!values.empty())
+        komodo_interest_batch(&interests[0], &values[0], &locktimes[0], &txheights[0], values.size(), pindex->nTime);
+
+    UniValue results(UniValue::VARR);
+    CAmount total = 0;
+    for (size_t i = 0; i < outputs.size(); i++) {
+        const UniValue& output = outputs[i].get_obj();
+        UniValue entry(UniValue::VOBJ);
+        entry.push_back(Pair("txid", find_value(output, "txid").get_str()));
+        entry.push_back(Pair("vout", find_value(output, "vout").get_int()));
+        entry.push_back(Pair("unspent", found[i] >= 0));
+        if (found[i] >= 0) {
+            uint64_t interest = interests[found[i]];
+            entry.push_back(Pair("value", ValueFromAmount(values[found[i]])));
+            entry.push_back(Pair("interest", ValueFromAmount(interest)));
+            total += interest;
+        }
+        results.push_back(entry);
+    }
+
+    UniValue ret(UniValue::VOBJ);
+    ret.push_back(Pair("bestblock", pindex->GetBlockHash().GetHex()));
+    ret.push_back(Pair("tiptime", (int64_t)pindex->nTime));
+    ret.push_back(Pair("outputs", results));
+    ret.push_back(Pair("total", ValueFromAmount(total)));
+    return ret;
+}
+
 UniValue verifychain(const UniValue& params, bool fHelp)
 {
     if (fHelp || params.size() > 2)
@@ -81,6 +81,7 @@ static const CRPCConvertParam vRPCConvertParams[] =
     { "fundrawtransaction", 1 },
     { "gettxout", 1 },
     { "gettxout", 2 },
+    { "calcinterest", 0 },
     { "gettxoutproof", 0 },
     { "lockunspent", 0 },
     { "lockunspent", 1 },
@@ -123,12 +124,16 @@ static const CRPCConvertParam vRPCConvertParams[] =
     { "z_importkey", 1 },
     { "paxprice", 4 },
     { "paxprices", 3 },
+    { "paxprices", 4 },
+    { "paxprices", 5 },
     { "paxpending", 0 },
     { "notaries", 2 },
     { "height_MoM", 1 },
     { "txMoMproof", 1 },
     { "minerids", 1 },
     { "kvsearch", 1 },
+    { "kvscan", 1 },
+    { "kvrange", 2 },
     { "kvupdate", 4 },
     { "z_importkey", 2 },
     { "z_importviewingkey", 2 },
@@ -288,6 +288,7 @@ static const CRPCCommand vRPCCommands[] =
     { "blockchain",         "getmempoolinfo",         &getmempoolinfo,         true  },
     { "blockchain",         "getrawmempool",          &getrawmempool,          true  },
     { "blockchain",         "gettxout",               &gettxout,               true  },
+    { "blockchain",         "calcinterest",           &calcinterest,           true  },
     { "blockchain",         "gettxoutproof",          &gettxoutproof,          true  },
     { "blockchain",         "verifytxoutproof",       &verifytxoutproof,       true  },
     { "blockchain",         "gettxoutsetinfo",        &gettxoutsetinfo,        true  },
@@ -300,6 +301,8 @@ static const CRPCCommand vRPCCommands[] =
     { "blockchain",         "txMoMproof",             &txMoMproof,             true  },
     { "blockchain",         "minerids",               &minerids,               true  },
     { "blockchain",         "kvsearch",               &kvsearch,               true  },
+    { "blockchain",         "kvscan",                 &kvscan,                 true  },
+    { "blockchain",         "kvrange",                &kvrange,                true  },
     { "blockchain",         "kvupdate",               &kvupdate,               true  },
 
     /* Mining */
@@ -276,6 +276,7 @@ extern UniValue getblockheader(const UniValue& params, bool fHelp);
 extern UniValue getblock(const UniValue& params, bool fHelp);
 extern UniValue gettxoutsetinfo(const UniValue& params, bool fHelp);
 extern UniValue gettxout(const UniValue& params, bool fHelp);
+extern UniValue calcinterest(const UniValue& params, bool fHelp);
 extern UniValue verifychain(const UniValue& params, bool fHelp);
 extern UniValue getchaintips(const UniValue& params, bool fHelp);
 extern UniValue invalidateblock(const UniValue& params, bool fHelp);
@@ -309,6 +310,8 @@ extern UniValue txMoMproof(const UniValue& params, bool fHelp);
 extern UniValue notaries(const UniValue& params, bool fHelp);
 extern UniValue minerids(const UniValue& params, bool fHelp);
 extern UniValue kvsearch(const UniValue& params, bool fHelp);
+extern UniValue kvscan(const UniValue& params, bool fHelp);
+extern UniValue kvrange(const UniValue& params, bool fHelp);
 extern UniValue kvupdate(const UniValue& params, bool fHelp);
 extern UniValue paxprice(const UniValue& params, bool fHelp);
 extern UniValue paxpending(const UniValue& params, bool fHelp);
@@ -0,0 +1,78 @@
+#include <gtest/gtest.h>
+
+#include "amount.h"
+#include "script/script.h"
+
+#include <vector>
+
+
+uint64_t komodo_interest(int32_t txheight,uint64_t nValue,uint32_t nLockTime,uint32_t tiptime);
+void komodo_interest_batch(uint64_t *interests,const uint64_t *values,const uint32_t *locktimes,const int32_t *txheights,int32_t n,uint32_t tiptime);
+
+
+namespace TestInterest {
+
+
+// Every era boundary of komodo_interest(), including the special cased outputs before 155949
+static const int32_t heights[] = {
+    0, 1, 60000, 116607, 126891, 129510, 141549, 154473, 154736, 155013, 155492, 155613,
+    155949, 155950, 157927, 249999, 250000, 250001, 999999, 1000000, 1000001, 7777776, 7777777, 8000000
+};
+
+static const uint64_t values[] = {
+    0, 1, 10*COIN - 1, 10*COIN, 10*COIN + 1, 12345678901LL, 25000LL*COIN, 25000LL*COIN + 1,
+    2502721100000LL, 2879650000000LL, 3000000000000LL, 3500000000000LL, 3983399350000LL,
+    3983406748175LL, 3983414006565LL, 3983427592291LL, 9997409999999797LL, 9997410667451072LL,
+    2590000000000LL, 4000000000000LL, 200000000LL*COIN
+};
+
+static const uint32_t tiptimes[] = { 0, 1491350399, 1491350400, 1530921600 };
+
+
+TEST(TestInterest, BatchMatchesScalar)
+{
+    for (int t = 0; t < sizeof(tiptimes)/sizeof(*tiptimes); t++) {
+        uint32_t tiptime = tiptimes[t];
+        uint32_t locktimes[] = {
+            0, LOCKTIME_THRESHOLD - 1, LOCKTIME_THRESHOLD, tiptime - 3599, tiptime - 3600, tiptime - 3660,
+            tiptime - 86400, tiptime - 365*24*3600, tiptime - 2*365*24*3600, tiptime, tiptime + 1
+        };
+        std::vector<uint64_t> vValues, vInterests;
+        std::vector<uint32_t> vLocktimes;
+        std::vector<int32_t> vHeights;
+        for (int h = 0; h < sizeof(heights)/sizeof(*heights); h++)
+            for (int v = 0; v < sizeof(values)/sizeof(*values); v++)
+                for (int l = 0; l < sizeof(locktimes)/sizeof(*locktimes); l++) {
+                    vHeights.push_back(heights[h]);
+                    vValues.push_back(values[v]);
+                    vLocktimes.push_back(locktimes[l]);
+                }
+        vInterests.resize(vValues.size());
+        komodo_interest_batch(&vInterests[0], &vValues[0], &vLocktimes[0], &vHeights[0], vValues.size(), tiptime);
+        for (int i = 0; i < vValues.size(); i++)
+            ASSERT_EQ(komodo_interest(vHeights[i], vValues[i], vLocktimes[i], tiptime), vInterests[i])
+                << "ht." << vHeights[i] << " value." << vValues[i] << " locktime." << vLocktimes[i] << " tiptime." << tiptime;
+    }
+}
+
+
+TEST(TestInterest, BatchMatchesScalarRandom)
+{
+    const int n = 100000;
+    uint32_t tiptime = 1530921600;
+    std::vector<uint64_t> vValues(n), vInterests(n);
+    std::vector<uint32_t> vLocktimes(n);
+    std::vector<int32_t> vHeights(n);
+    srand(1);
+    for (int i = 0; i < n; i++) {
+        vHeights[i] = 250000 + rand() % 2000000;
+        vValues[i] = ((uint64_t)rand() << 20 | rand()) % (100000LL*COIN);
+        vLocktimes[i] = tiptime - rand() % (400*24*3600);
+    }
+    komodo_interest_batch(&vInterests[0], &vValues[0], &vLocktimes[0], &vHeights[0], n, tiptime);
+    for (int i = 0; i < n; i++)
+        ASSERT_EQ(komodo_interest(vHeights[i], vValues[i], vLocktimes[i], tiptime), vInterests[i]);
+}
+
+
+} /* namespace TestInterest */
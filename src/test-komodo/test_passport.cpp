@@ -0,0 +1,196 @@
+#include <gtest/gtest.h>
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <vector>
+
+
+struct komodo_tail;
+struct komodo_tail *komodo_tail_open(char *fname,long pos);
+void komodo_tail_close(struct komodo_tail *tp);
+long komodo_tail_read(struct komodo_tail *tp,uint8_t **datap);
+void komodo_tail_consume(struct komodo_tail *tp,long n);
+long komodo_staterecordlen(uint8_t *data,long datalen);
+long komodo_staterecover(FILE *fp,char *fname,long snappos);
+
+
+namespace TestPassport {
+
+
+// 'K', 'T' and 'R' records the way komodo_stateupdate appends them
+static std::vector<uint8_t> MakeRecords(int n)
+{
+    std::vector<uint8_t> out;
+    for (int32_t i = 0; i < n; i++) {
+        uint8_t type = "KTR"[i % 3];
+        out.push_back(type);
+        out.insert(out.end(), (uint8_t *)&i, (uint8_t *)&i + sizeof(i));
+        if (type == 'K') {
+            out.insert(out.end(), (uint8_t *)&i, (uint8_t *)&i + sizeof(i));
+        } else if (type == 'T') {
+            uint32_t t = 1500000000 + i;
+            out.insert(out.end(), (uint8_t *)&i, (uint8_t *)&i + sizeof(i));
+            out.insert(out.end(), (uint8_t *)&t, (uint8_t *)&t + sizeof(t));
+        } else {
+            uint8_t txid[32]; uint16_t v = i; uint64_t ovalue = i; uint16_t olen = i % 50;
+            memset(txid, i, sizeof(txid));
+            out.insert(out.end(), txid, txid + sizeof(txid));
+            out.insert(out.end(), (uint8_t *)&v, (uint8_t *)&v + sizeof(v));
+            out.insert(out.end(), (uint8_t *)&ovalue, (uint8_t *)&ovalue + sizeof(ovalue));
+            out.insert(out.end(), (uint8_t *)&olen, (uint8_t *)&olen + sizeof(olen));
+            out.insert(out.end(), olen, (uint8_t)i);
+        }
+    }
+    return out;
+}
+
+
+TEST(TestPassport, TailDeliversWholeRecordsInOrder)
+{
+    char fname[] = "/tmp/komodostate.XXXXXX";
+    int fd = mkstemp(fname);
+    ASSERT_GE(fd, 0);
+    FILE *fp = fdopen(fd, "wb");
+
+    std::vector<uint8_t> records = MakeRecords(300), parsed;
+    struct komodo_tail *tp = komodo_tail_open(fname, 0);
+    uint8_t *data; long datalen, n, fpos;
+    size_t written = 0, chunk = 1;
+
+    // the writer daemon appends in chunks that split records at arbitrary offsets
+    while (written < records.size()) {
+        chunk = std::min((chunk * 7) % 61 + 1, records.size() - written);
+        fwrite(&records[written], 1, chunk, fp);
+        fflush(fp);
+        written += chunk;
+        datalen = komodo_tail_read(tp, &data);
+        for (fpos = 0; (n= komodo_staterecordlen(&data[fpos], datalen - fpos)) > 0; fpos += n)
+            parsed.insert(parsed.end(), &data[fpos], &data[fpos + n]);
+        komodo_tail_consume(tp, fpos);
+    }
+    EXPECT_EQ(records, parsed);
+
+    // nothing new, nothing left over
+    EXPECT_EQ(0, komodo_tail_read(tp, &data));
+
+    komodo_tail_close(tp);
+    fclose(fp);
+    unlink(fname);
+}
+
+
+TEST(TestPassport, PartialRecordIsNotComplete)
+{
+    std::vector<uint8_t> records = MakeRecords(3);
+    long total = 0, len;
+    for (int i = 0; i < 3; i++) {
+        len = komodo_staterecordlen(&records[total], records.size() - total);
+        ASSERT_GT(len, 0);
+        for (long j = 0; j < len; j++)
+            EXPECT_EQ(0, komodo_staterecordlen(&records[total], j));
+        total += len;
+    }
+    EXPECT_EQ(records.size(), total);
+
+    uint8_t unknown[16] = { 'Z' };
+    EXPECT_EQ(-1, komodo_staterecordlen(unknown, sizeof(unknown)));
+}
+
+
+// what komodo_stateupdate replays from fp after the recovery when there is no snapshot
+static std::vector<uint8_t> ReplayRecords(FILE *fp)
+{
+    std::vector<uint8_t> data, replayed;
+    uint8_t buf[4096]; size_t n; long fpos, len;
+    while ((n = fread(buf, 1, sizeof(buf), fp)) > 0)
+        data.insert(data.end(), buf, buf + n);
+    for (fpos = 0; fpos < (long)data.size() && (len = komodo_staterecordlen(&data[fpos], data.size() - fpos)) > 0; fpos += len)
+        replayed.insert(replayed.end(), &data[fpos], &data[fpos + len]);
+    return replayed;
+}
+
+
+TEST(TestPassport, RecoverDropsPartialTrailingRecord)
+{
+    char fname[] = "/tmp/komodostate.XXXXXX";
+    int fd = mkstemp(fname);
+    ASSERT_GE(fd, 0);
+    FILE *fp = fdopen(fd, "rb+");
+
+    // a crash in the middle of appending the last record
+    std::vector<uint8_t> records = MakeRecords(100);
+    long complete = records.size();
+    std::vector<uint8_t> next = MakeRecords(101);
+    fwrite(&records[0], 1, records.size(), fp);
+    fwrite(&next[complete], 1, (next.size() - complete) / 2, fp);
+    fflush(fp);
+
+    // no snapshot: the whole file is scanned, and the replay that follows still starts at the beginning
+    rewind(fp);
+    EXPECT_EQ(complete, komodo_staterecover(fp, fname, -1));
+    EXPECT_EQ(0, ftell(fp));
+    EXPECT_EQ(records, ReplayRecords(fp));
+    fseek(fp, 0, SEEK_END);
+    EXPECT_EQ(complete, ftell(fp));
+
+    // whole records are left alone, also when scanning from a snapshot's record boundary
+    fwrite(&next[complete], 1, (next.size() - complete) / 2, fp);
+    fflush(fp);
+    long snappos = komodo_staterecordlen(&records[0], records.size());
+    EXPECT_EQ(complete, komodo_staterecover(fp, fname, snappos));
+    EXPECT_EQ(complete, komodo_staterecover(fp, fname, snappos));
+    fseek(fp, 0, SEEK_END);
+    EXPECT_EQ(complete, ftell(fp));
+
+    fclose(fp);
+    unlink(fname);
+}
+
+
+TEST(TestPassport, TailDropsPartialRecordCutOffByTheWriter)
+{
+    char fname[] = "/tmp/komodostate.XXXXXX";
+    int fd = mkstemp(fname);
+    ASSERT_GE(fd, 0);
+    FILE *fp = fdopen(fd, "rb+");
+
+    std::vector<uint8_t> records = MakeRecords(20), parsed;
+    long complete = MakeRecords(10).size();
+    struct komodo_tail *tp = komodo_tail_open(fname, 0);
+    uint8_t *data; long datalen, n, fpos;
+
+    // the reader buffers the start of a record that never completes, then the writer crashes and cuts it off on restart
+    std::vector<uint8_t> torn = MakeRecords(12);
+    fwrite(&records[0], 1, complete, fp);
+    fwrite(&torn[MakeRecords(11).size()], 1, 3, fp);
+    fflush(fp);
+    datalen = komodo_tail_read(tp, &data);
+    for (fpos = 0; (n = komodo_staterecordlen(&data[fpos], datalen - fpos)) > 0; fpos += n)
+        parsed.insert(parsed.end(), &data[fpos], &data[fpos + n]);
+    komodo_tail_consume(tp, fpos);
+    EXPECT_EQ(complete, fpos);
+    fflush(fp);
+    ASSERT_EQ(0, ftruncate(fileno(fp), complete));
+    EXPECT_EQ(0, komodo_tail_read(tp, &data));
+
+    // and appends the remaining records again from the boundary
+    fseek(fp, complete, SEEK_SET);
+    fwrite(&records[complete], 1, records.size() - complete, fp);
+    fflush(fp);
+    datalen = komodo_tail_read(tp, &data);
+    for (fpos = 0; (n = komodo_staterecordlen(&data[fpos], datalen - fpos)) > 0; fpos += n)
+        parsed.insert(parsed.end(), &data[fpos], &data[fpos + n]);
+    komodo_tail_consume(tp, fpos);
+    EXPECT_EQ(records, parsed);
+
+    komodo_tail_close(tp);
+    fclose(fp);
+    unlink(fname);
+}
+
+}
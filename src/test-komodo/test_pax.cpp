@@ -0,0 +1,149 @@
+#include <gtest/gtest.h>
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <set>
+#include <vector>
+
+#include "uint256.h"
+
+extern int32_t NUM_PRICES; extern uint32_t *PVALS;
+void komodo_pvals_compact();
+int32_t komodo_pvalsfind(int32_t height);
+int32_t komodo_paxprices(int32_t *heights,uint64_t *prices,int32_t max,char *base,char *rel,int32_t fromheight,int32_t toheight,int32_t interval);
+struct pax_transaction;
+extern struct pax_transaction **PAX_PENDING; extern int32_t NUM_PAX_PENDING;
+struct pax_transaction *komodo_paxmark(int32_t height,uint256 txid,uint16_t vout,uint8_t type,int32_t mark);
+
+
+namespace TestPax {
+
+
+// what _komodo_paxprice did before the rows were kept sorted: the newest row appended below height
+static int32_t LinearFind(const std::vector<uint32_t> &rows, int32_t height)
+{
+    for (int32_t i = rows.size()/36 - 1; i >= 0; i--)
+        if ((int32_t)rows[36 * i] < height)
+            return i;
+    return -1;
+}
+
+static void SetPvals(const std::vector<uint32_t> &rows)
+{
+    NUM_PRICES = rows.size() / 36;
+    PVALS = (uint32_t *)realloc(PVALS, sizeof(*PVALS) * rows.size());
+    memcpy(PVALS, &rows[0], sizeof(*PVALS) * rows.size());
+}
+
+
+TEST(TestPax, CompactedRowsAnswerLikeTheLinearScan)
+{
+    // a reorg back to 996 replayed after 1000, then another back to 990
+    const int32_t heights[] = { 990, 991, 995, 998, 999, 1000, 996, 997, 990, 992, 1001 };
+    std::vector<uint32_t> rows;
+    for (int i = 0; i < sizeof(heights)/sizeof(*heights); i++) {
+        rows.push_back(heights[i]);
+        for (int j = 1; j < 36; j++)
+            rows.push_back(i * 100 + j);
+    }
+    SetPvals(rows);
+    komodo_pvals_compact();
+    ASSERT_EQ(3, NUM_PRICES); // 990, 992, 1001
+    for (int32_t i = 1; i < NUM_PRICES; i++)
+        EXPECT_LT(PVALS[36 * (i-1)], PVALS[36 * i]);
+
+    for (int32_t height = 980; height < 1010; height++) {
+        int32_t linear = LinearFind(rows, height), found = komodo_pvalsfind(height);
+        if (linear < 0) {
+            EXPECT_EQ(-1, found);
+        } else {
+            ASSERT_GE(found, 0);
+            EXPECT_EQ(0, memcmp(&rows[36 * linear], &PVALS[36 * found], sizeof(*PVALS) * 36)) << height;
+        }
+    }
+}
+
+
+TEST(TestPax, FindOnSortedRows)
+{
+    std::vector<uint32_t> rows(36 * 3);
+    rows[0] = 10; rows[36] = 20; rows[72] = 30;
+    SetPvals(rows);
+    komodo_pvals_compact();
+    ASSERT_EQ(3, NUM_PRICES);
+    EXPECT_EQ(-1, komodo_pvalsfind(10));
+    EXPECT_EQ(0, komodo_pvalsfind(11));
+    EXPECT_EQ(0, komodo_pvalsfind(20));
+    EXPECT_EQ(1, komodo_pvalsfind(21));
+    EXPECT_EQ(2, komodo_pvalsfind(31));
+    EXPECT_EQ(2, komodo_pvalsfind(1 << 30));
+}
+
+
+static std::vector<int32_t> PriceHeights(int32_t max, int32_t fromheight, int32_t toheight, int32_t interval)
+{
+    int32_t heights[128]; uint64_t prices[128];
+    int32_t n = komodo_paxprices(heights, prices, max, (char *)"USD", (char *)"EUR", fromheight, toheight, interval);
+    return std::vector<int32_t>(heights, heights + n);
+}
+
+
+TEST(TestPax, PricesHonourRangeAndInterval)
+{
+    std::vector<uint32_t> rows;
+    for (int32_t height = 1; height <= 100; height++) {
+        rows.push_back(height);
+        for (int j = 1; j < 36; j++)
+            rows.push_back(1000000 + j);
+    }
+    SetPvals(rows);
+
+    // newest first, one row per interval
+    EXPECT_EQ(std::vector<int32_t>({ 100, 99, 89, 79, 69, 59, 49, 39, 29, 19, 9 }), PriceHeights(128, 0, 0, 10));
+    // nothing below fromheight
+    EXPECT_EQ(std::vector<int32_t>({ 100, 99, 89, 79, 69, 59 }), PriceHeights(128, 50, 0, 10));
+    // toheight itself is excluded
+    EXPECT_EQ(std::vector<int32_t>({ 59, 49 }), PriceHeights(128, 40, 60, 10));
+    // every row without an interval, capped by max
+    EXPECT_EQ(std::vector<int32_t>({ 100, 99, 98 }), PriceHeights(3, 0, 0, 0));
+    EXPECT_EQ(std::vector<int32_t>({ 5, 4, 3, 2, 1 }), PriceHeights(128, 0, 6, 1));
+}
+
+
+static uint256 PaxTxid(uint32_t i)
+{
+    uint256 txid;
+    memcpy(txid.begin(), &i, sizeof(i));
+    txid.begin()[31] = 0x7a;
+    return txid;
+}
+
+
+TEST(TestPax, PendingQueueHasNoDuplicatesAndDropsMarked)
+{
+    int32_t base = NUM_PAX_PENDING;
+    std::set<struct pax_transaction *> marked;
+
+    // marking an entry unmarked again must not queue it twice
+    for (uint32_t i = 0; i < 100; i++) {
+        komodo_paxmark(1, PaxTxid(i), 0, 'W', 0);
+        komodo_paxmark(1, PaxTxid(i), 0, 'W', 0);
+    }
+    EXPECT_EQ(base + 100, NUM_PAX_PENDING);
+
+    // marked entries leave the queue once it fills up, even without komodo_paxtotal
+    for (uint32_t i = 0; i < 100; i++)
+        marked.insert(komodo_paxmark(2, PaxTxid(i), 0, 'W', 2));
+    for (uint32_t i = 100; i < 2100; i++)
+        komodo_paxmark(3, PaxTxid(i), 0, 'W', 0);
+    EXPECT_EQ(base + 2000, NUM_PAX_PENDING);
+    std::set<struct pax_transaction *> queued(PAX_PENDING, PAX_PENDING + NUM_PAX_PENDING);
+    EXPECT_EQ((size_t)NUM_PAX_PENDING, queued.size());
+    for (std::set<struct pax_transaction *>::iterator it = marked.begin(); it != marked.end(); ++it)
+        EXPECT_EQ(0, queued.count(*it));
+}
+
+
+}
@@ -772,8 +772,8 @@ BOOST_AUTO_TEST_CASE(coins_coinbase_spends)
 
 BOOST_AUTO_TEST_CASE(ccoins_serialization)
 {
-    // Good example
-    CDataStream ss1(ParseHex("0104835800816115944e077fe7c803cfa57f29b36bf87c1d358bb85e"), SER_DISK, CLIENT_VERSION);
+    // Good example, from before nLockTime was stored
+    CDataStream ss1(ParseHex("0104835800816115944e077fe7c803cfa57f29b36bf87c1d358bb85e"), SER_DISK, COINS_LOCKTIME_VERSION - 1);
     CCoins cc1;
     ss1 >> cc1;
     BOOST_CHECK_EQUAL(cc1.nVersion, 1);
@@ -784,9 +784,21 @@ BOOST_AUTO_TEST_CASE(ccoins_serialization)
     BOOST_CHECK_EQUAL(cc1.IsAvailable(1), true);
     BOOST_CHECK_EQUAL(cc1.vout[1].nValue, 60000000000ULL);
     BOOST_CHECK_EQUAL(HexStr(cc1.vout[1].scriptPubKey), HexStr(GetScriptForDestination(CKeyID(uint160(ParseHex("816115944e077fe7c803cfa57f29b36bf87c1d35"))))));
+    BOOST_CHECK_EQUAL(cc1.nLockTime, 0);
+
+    // Same coins with nLockTime appended
+    CDataStream ss1l(ParseHex("0104835800816115944e077fe7c803cfa57f29b36bf87c1d358bb85e78563412"), SER_DISK, CLIENT_VERSION);
+    CCoins cc1l;
+    ss1l >> cc1l;
+    BOOST_CHECK_EQUAL(cc1l.nHeight, 203998);
+    BOOST_CHECK_EQUAL(cc1l.nLockTime, 0x12345678);
+    BOOST_CHECK(cc1l.vout == cc1.vout);
+    CDataStream ss1r(SER_DISK, CLIENT_VERSION);
+    ss1r << cc1l;
+    BOOST_CHECK_EQUAL(HexStr(ss1r.begin(), ss1r.end()), "0104835800816115944e077fe7c803cfa57f29b36bf87c1d358bb85e78563412");
 
     // Good example
-    CDataStream ss2(ParseHex("0109044086ef97d5790061b01caab50f1b8e9c50a5057eb43c2d9563a4eebbd123008c988f1a4a4de2161e0f50aac7f17e7f9555caa486af3b"), SER_DISK, CLIENT_VERSION);
+    CDataStream ss2(ParseHex("0109044086ef97d5790061b01caab50f1b8e9c50a5057eb43c2d9563a4eebbd123008c988f1a4a4de2161e0f50aac7f17e7f9555caa486af3b"), SER_DISK, COINS_LOCKTIME_VERSION - 1);
     CCoins cc2;
     ss2 >> cc2;
     BOOST_CHECK_EQUAL(cc2.nVersion, 1);
@@ -805,7 +817,7 @@ BOOST_AUTO_TEST_CASE(ccoins_serialization)
     CDataStream ssx(SER_DISK, CLIENT_VERSION);
     BOOST_CHECK_EQUAL(HexStr(ssx.begin(), ssx.end()), "");
 
-    CDataStream ss3(ParseHex("0002000600"), SER_DISK, CLIENT_VERSION);
+    CDataStream ss3(ParseHex("0002000600"), SER_DISK, COINS_LOCKTIME_VERSION - 1);
     CCoins cc3;
     ss3 >> cc3;
     BOOST_CHECK_EQUAL(cc3.nVersion, 0);
@@ -839,4 +851,36 @@ BOOST_AUTO_TEST_CASE(ccoins_serialization)
     }
 }
 
+BOOST_AUTO_TEST_CASE(txinundo_serialization)
+{
+    CTxOut txout(60000000000ULL, GetScriptForDestination(CKeyID(uint160(ParseHex("816115944e077fe7c803cfa57f29b36bf87c1d35")))));
+    CTxInUndo undo(txout, false, 203998, 1, 0x12345678);
+
+    // Undo data written before nLockTime was stored does not carry it
+    CDataStream ss1(SER_DISK, COINS_LOCKTIME_VERSION - 1);
+    ss1 << undo;
+    CDataStream ss1l(SER_DISK, CLIENT_VERSION);
+    ss1l << undo;
+    BOOST_CHECK_EQUAL(ss1l.size(), ss1.size() + 4);
+    CTxInUndo u1;
+    ss1 >> u1;
+    BOOST_CHECK_EQUAL(u1.nHeight, 203998);
+    BOOST_CHECK_EQUAL(u1.nLockTime, 0);
+    BOOST_CHECK(u1.txout == txout);
+
+    CTxInUndo u1l;
+    ss1l >> u1l;
+    BOOST_CHECK_EQUAL(u1l.nHeight, 203998);
+    BOOST_CHECK_EQUAL(u1l.nVersion, 1);
+    BOOST_CHECK_EQUAL(u1l.nLockTime, 0x12345678);
+    BOOST_CHECK(u1l.txout == txout);
+
+    // Only the last spent output of a transaction carries its metadata
+    CTxInUndo undo2(txout);
+    CDataStream ss2(SER_DISK, COINS_LOCKTIME_VERSION - 1), ss2l(SER_DISK, CLIENT_VERSION);
+    ss2 << undo2;
+    ss2l << undo2;
+    BOOST_CHECK_EQUAL(ss2l.size(), ss2.size());
+}
+
 BOOST_AUTO_TEST_SUITE_END()
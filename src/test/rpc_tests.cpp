@@ -296,6 +296,32 @@ BOOST_AUTO_TEST_CASE(rpc_ban)
     BOOST_CHECK_EQUAL(adr.get_str(), "2001:4d48:ac57:400:cacf:e9ff:fe1d:9c63/ffff:ffff:ffff:ffff:ffff:ffff:ffff:ffff");
 }
 
+BOOST_AUTO_TEST_CASE(rpc_paxprices_params)
+{
+    // komodo-cli sends fromheight, toheight and interval as numbers
+    vector<string> vArgs;
+    boost::split(vArgs, "USD EUR 10 100 200 5", boost::is_any_of(" "));
+    UniValue params = RPCConvertValues("paxprices", vArgs);
+    BOOST_CHECK(params[3].isNum() && params[4].isNum() && params[5].isNum());
+
+    UniValue r;
+    BOOST_CHECK_NO_THROW(r = CallRPC("paxprices USD EUR 10"));
+    BOOST_CHECK(find_value(r.get_obj(), "array").isArray());
+    BOOST_CHECK_NO_THROW(CallRPC("paxprices USD EUR 10 100"));
+    BOOST_CHECK_NO_THROW(CallRPC("paxprices USD EUR 10 100 200 5"));
+
+    // and raw JSON-RPC callers may still send strings
+    UniValue strparams(UniValue::VARR);
+    strparams.push_back("USD");
+    strparams.push_back("EUR");
+    strparams.push_back("10");
+    strparams.push_back("100");
+    strparams.push_back("200");
+    strparams.push_back("5");
+    BOOST_CHECK_NO_THROW(tableRPC["paxprices"]->actor(strparams, false));
+    BOOST_CHECK_THROW(tableRPC["paxprices"]->actor(UniValue(UniValue::VARR), false), runtime_error);
+}
+
 
 BOOST_AUTO_TEST_CASE(rpc_raw_create_overwinter_v3)
 {
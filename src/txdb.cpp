@@ -19,10 +19,12 @@ using namespace std;
 
 static const char DB_ANCHOR = 'A';
 static const char DB_NULLIFIER = 's';
-static const char DB_COINS = 'c';
+static const char DB_COINS = 'C';
+static const char DB_LEGACY_COINS = 'c'; // coins without nLockTime, written before COINS_LOCKTIME_VERSION
 static const char DB_BLOCK_FILES = 'f';
 static const char DB_TXINDEX = 't';
 static const char DB_BLOCK_INDEX = 'b';
+static const char DB_NOTARIZATION = 'N';
 
 static const char DB_BEST_BLOCK = 'B';
 static const char DB_BEST_ANCHOR = 'a';
@@ -181,6 +183,87 @@ bool CBlockTreeDB::ReadLastBlockFile(int &nFile) {
     return Read(DB_LAST_BLOCK, nFile);
 }
 
+bool CCoinsViewDB::UpgradeLockTimes() {
+    boost::scoped_ptr<leveldb::Iterator> pcursor(db.NewIterator());
+    CDataStream ssKeySet(SER_DISK, CLIENT_VERSION);
+    ssKeySet << make_pair(DB_LEGACY_COINS, uint256());
+    pcursor->Seek(ssKeySet.str());
+    if (!pcursor->Valid() || pcursor->key().size() == 0 || pcursor->key()[0] != DB_LEGACY_COINS)
+        return true;
+
+    // Entries written by older versions lack nLockTime and are kept under DB_LEGACY_COINS, so an
+    // older build never sees the new format. They are moved to DB_COINS in height order, reading
+    // every block once. Each batch moves its entries atomically, an interrupted upgrade resumes.
+    LogPrintf("Upgrading chainstate database with transaction locktimes...\n");
+    std::vector<std::pair<int, uint256> > vLegacy;
+    for (; pcursor->Valid(); pcursor->Next()) {
+        boost::this_thread::interruption_point();
+        try {
+            leveldb::Slice slKey = pcursor->key();
+            CDataStream ssKey(slKey.data(), slKey.data()+slKey.size(), SER_DISK, CLIENT_VERSION);
+            char chType;
+            ssKey >> chType;
+            if (chType != DB_LEGACY_COINS)
+                break;
+            uint256 txhash;
+            ssKey >> txhash;
+            leveldb::Slice slValue = pcursor->value();
+            CDataStream ssValue(slValue.data(), slValue.data()+slValue.size(), SER_DISK, COINS_LOCKTIME_VERSION - 1);
+            CCoins coins;
+            ssValue >> coins;
+            vLegacy.push_back(make_pair(coins.nHeight, txhash));
+        } catch (const std::exception& e) {
+            return error("%s: Deserialize or I/O error - %s", __func__, e.what());
+        }
+    }
+    std::sort(vLegacy.begin(), vLegacy.end());
+
+    CLevelDBBatch batch;
+    size_t nBatch = 0;
+    for (size_t i = 0; i < vLegacy.size(); ) {
+        boost::this_thread::interruption_point();
+        int nHeight = vLegacy[i].first;
+        CBlockIndex *pindex = chainActive[nHeight];
+        CBlock block;
+        if (pindex == NULL || !(pindex->nStatus & BLOCK_HAVE_DATA) || !ReadBlockFromDisk(block, pindex))
+            return error("%s: block at height %d is not available to fill in locktimes, -reindex required", __func__, nHeight);
+        std::map<uint256, uint32_t> mapLockTimes;
+        for (size_t j = 0; j < block.vtx.size(); j++)
+            mapLockTimes[block.vtx[j].GetHash()] = block.vtx[j].nLockTime;
+        for (; i < vLegacy.size() && vLegacy[i].first == nHeight; i++) {
+            const uint256 &txhash = vLegacy[i].second;
+            std::map<uint256, uint32_t>::const_iterator it = mapLockTimes.find(txhash);
+            if (it == mapLockTimes.end())
+                return error("%s: transaction %s not found in block at height %d, -reindex required", __func__, txhash.ToString(), nHeight);
+            CDataStream ssKey(SER_DISK, CLIENT_VERSION);
+            ssKey << make_pair(DB_LEGACY_COINS, txhash);
+            pcursor->Seek(ssKey.str());
+            if (!pcursor->Valid() || pcursor->key().ToString() != ssKey.str())
+                return error("%s: chainstate entry %s disappeared during the upgrade", __func__, txhash.ToString());
+            CCoins coins;
+            try {
+                leveldb::Slice slValue = pcursor->value();
+                CDataStream ssValue(slValue.data(), slValue.data()+slValue.size(), SER_DISK, COINS_LOCKTIME_VERSION - 1);
+                ssValue >> coins;
+            } catch (const std::exception& e) {
+                return error("%s: Deserialize or I/O error - %s", __func__, e.what());
+            }
+            coins.nLockTime = it->second;
+            batch.Erase(make_pair(DB_LEGACY_COINS, txhash));
+            BatchWriteCoins(batch, txhash, coins);
+            nBatch++;
+        }
+        if (nBatch >= 10000 || i == vLegacy.size()) {
+            if (!db.WriteBatch(batch, i == vLegacy.size()))
+                return false;
+            batch = CLevelDBBatch();
+            nBatch = 0;
+        }
+    }
+    LogPrintf("Upgraded %u chainstate entries\n", vLegacy.size());
+    return true;
+}
+
 bool CCoinsViewDB::GetStats(CCoinsStats &stats) const {
     /* It seems that there are no "const iterators" for LevelDB.  Since we
        only need read operations on it, use a const-cast to get around
@@ -272,6 +355,45 @@ bool CBlockTreeDB::ReadFlag(const std::string &name, bool &fValue) {
     return true;
 }
 
+bool CBlockTreeDB::ReadNotarization(const std::string &dest, const uint256 &desttxid, int &nHeight, uint256 &hash, uint256 &MoM) {
+    std::pair<int, std::pair<uint256, uint256> > value;
+    if (!Read(make_pair(DB_NOTARIZATION, make_pair(dest, desttxid)), value))
+        return false;
+    nHeight = value.first;
+    hash = value.second.first;
+    MoM = value.second.second;
+    return true;
+}
+
+bool CBlockTreeDB::WriteNotarization(const std::string &dest, const uint256 &desttxid, int nHeight, const uint256 &hash, const uint256 &MoM) {
+    return Write(make_pair(DB_NOTARIZATION, make_pair(dest, desttxid)), make_pair(nHeight, make_pair(hash, MoM)));
+}
+
+bool CBlockTreeDB::EraseNotarizations() {
+    boost::scoped_ptr<leveldb::Iterator> pcursor(NewIterator());
+    CLevelDBBatch batch;
+    int64_t nErased = 0;
+
+    CDataStream ssKeySet(SER_DISK, CLIENT_VERSION);
+    ssKeySet << DB_NOTARIZATION;
+    pcursor->Seek(ssKeySet.str());
+    while (pcursor->Valid()) {
+        leveldb::Slice slKey = pcursor->key();
+        CDataStream ssKey(slKey.data(), slKey.data()+slKey.size(), SER_DISK, CLIENT_VERSION);
+        char chType;
+        std::pair<std::string, uint256> key;
+        ssKey >> chType;
+        if (chType != DB_NOTARIZATION)
+            break;
+        ssKey >> key;
+        batch.Erase(make_pair(DB_NOTARIZATION, key));
+        nErased++;
+        pcursor->Next();
+    }
+    LogPrintf("%s: erased %d cached notarizations\n", __func__, nErased);
+    return WriteBatch(batch, true);
+}
+
 void komodo_index2pubkey33(uint8_t *pubkey33,CBlockIndex *pindex,int32_t height);
 
 bool CBlockTreeDB::LoadBlockIndexGuts()
@@ -281,6 +403,7 @@ bool CBlockTreeDB::LoadBlockIndexGuts()
     CDataStream ssKeySet(SER_DISK, CLIENT_VERSION);
     ssKeySet << make_pair(DB_BLOCK_INDEX, uint256());
     pcursor->Seek(ssKeySet.str());
+    std::vector<const CBlockIndex*> vMigrated;
 
     // Load mapBlockIndex
     while (pcursor->Valid()) {
@@ -293,6 +416,11 @@ bool CBlockTreeDB::LoadBlockIndexGuts()
             if (chType == DB_BLOCK_INDEX) {
                 leveldb::Slice slValue = pcursor->value();
                 CDataStream ssValue(slValue.data(), slValue.data()+slValue.size(), SER_DISK, CLIENT_VERSION);
+                // peek at the version the entry was written with, without copying it
+                int nDiskVersion = 0;
+                CDataStream::size_type nValueSize = ssValue.size();
+                ssValue >> VARINT(nDiskVersion);
+                ssValue.Rewind(nValueSize - ssValue.size());
                 CDiskBlockIndex diskindex;
                 ssValue >> diskindex;
 
@@ -316,6 +444,8 @@ bool CBlockTreeDB::LoadBlockIndexGuts()
                 pindexNew->nCachedBranchId = diskindex.nCachedBranchId;
                 pindexNew->nTx            = diskindex.nTx;
                 pindexNew->nSproutValue   = diskindex.nSproutValue;
+                pindexNew->notaryid       = diskindex.notaryid;
+                memcpy(pindexNew->pubkey33, diskindex.pubkey33, sizeof(pindexNew->pubkey33));
                 
                 // Consistency checks
                 auto header = pindexNew->GetBlockHeader();
@@ -323,7 +453,14 @@ bool CBlockTreeDB::LoadBlockIndexGuts()
                     return error("LoadBlockIndex(): block header inconsistency detected: on-disk = %s, in-memory = %s",
                                  diskindex.ToString(),  pindexNew->ToString());
                 uint8_t pubkey33[33];
-                komodo_index2pubkey33(pubkey33,pindexNew,pindexNew->nHeight);
+                if (nDiskVersion >= NOTARYPUBKEY_VERSION)
+                    memcpy(pubkey33, pindexNew->pubkey33, sizeof(pubkey33));
+                else
+                {
+                    // Entry predates the stored pubkey, read it from the block once and rewrite
+                    komodo_index2pubkey33(pubkey33,pindexNew,pindexNew->nHeight);
+                    vMigrated.push_back(pindexNew);
+                }
                 if (!CheckProofOfWork(pindexNew->nHeight,pubkey33,pindexNew->GetBlockHash(), pindexNew->nBits, Params().GetConsensus()))
                     return error("LoadBlockIndex(): CheckProofOfWork failed: %s", pindexNew->ToString());
                 pcursor->Next();
@@ -335,5 +472,15 @@ bool CBlockTreeDB::LoadBlockIndexGuts()
         }
     }
 
+    if (!vMigrated.empty()) {
+        LogPrintf("%s: storing notary pubkeys for %u block index entries\n", __func__, vMigrated.size());
+        CLevelDBBatch batch;
+        for (std::vector<const CBlockIndex*>::const_iterator it=vMigrated.begin(); it != vMigrated.end(); it++) {
+            batch.Write(make_pair(DB_BLOCK_INDEX, (*it)->GetBlockHash()), CDiskBlockIndex(*it));
+        }
+        if (!WriteBatch(batch, true))
+            return error("LoadBlockIndex(): failed to write migrated block index entries");
+    }
+
     return true;
 }
@@ -47,6 +47,9 @@ public:
                     CAnchorsMap &mapAnchors,
                     CNullifiersMap &mapNullifiers);
     bool GetStats(CCoinsStats &stats) const;
+    //! Store nLockTime in coins written before COINS_LOCKTIME_VERSION.
+    //! One way only: older builds do not read DB_COINS, going back to one needs -reindex
+    bool UpgradeLockTimes();
 };
 
 /** Access to the block database (blocks/index/) */
@@ -67,6 +70,10 @@ public:
     bool WriteTxIndex(const std::vector<std::pair<uint256, CDiskTxPos> > &list);
     bool WriteFlag(const std::string &name, bool fValue);
     bool ReadFlag(const std::string &name, bool &fValue);
+    //! notarization data found in desttxid on the dest chain, which never changes once that tx exists
+    bool ReadNotarization(const std::string &dest, const uint256 &desttxid, int &nHeight, uint256 &hash, uint256 &MoM);
+    bool WriteNotarization(const std::string &dest, const uint256 &desttxid, int nHeight, const uint256 &hash, const uint256 &MoM);
+    bool EraseNotarizations();
     bool LoadBlockIndexGuts();
 };
 
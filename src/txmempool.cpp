@@ -19,6 +19,9 @@
 
 using namespace std;
 
+void komodo_kvpending_remove(const CTransaction &tx);
+void komodo_kvpending_clear();
+
 CTxMemPoolEntry::CTxMemPoolEntry():
     nFee(0), nTxSize(0), nModSize(0), nUsageSize(0), nTime(0), dPriority(0.0),
     hadNoDependencies(false), spendsCoinbase(false)
@@ -163,6 +166,7 @@ void CTxMemPool::remove(const CTransaction &origTx, std::list<CTransaction>& rem
             }
 
             removed.push_back(tx);
+            komodo_kvpending_remove(tx);
             totalTxSize -= mapTx.find(hash)->GetTxSize();
             cachedInnerUsage -= mapTx.find(hash)->DynamicMemoryUsage();
             mapTx.erase(hash);
@@ -334,6 +338,7 @@ void CTxMemPool::clear()
     LOCK(cs);
     mapTx.clear();
     mapNextTx.clear();
+    komodo_kvpending_clear();
     totalTxSize = 0;
     cachedInnerUsage = 0;
     ++nTransactionsUpdated;
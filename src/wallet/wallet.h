@@ -376,6 +376,7 @@ public:
     mutable CAmount nImmatureWatchCreditCached;
     mutable CAmount nAvailableWatchCreditCached;
     mutable CAmount nChangeCached;
+    mutable const CBlockIndex* pindexInterestCached; //! tip that vout[].interest was computed for
 
     CWalletTx()
     {
@@ -426,6 +427,7 @@ public:
         nAvailableWatchCreditCached = 0;
         nImmatureWatchCreditCached = 0;
         nChangeCached = 0;
+        pindexInterestCached = NULL;
         nOrderPos = -1;
     }
 
@@ -485,6 +487,7 @@ public:
         fImmatureWatchCreditCached = false;
         fDebitCached = false;
         fChangeCached = false;
+        pindexInterestCached = NULL;
     }
 
     void BindWallet(CWallet *pwalletIn)
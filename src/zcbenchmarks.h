@@ -19,5 +19,7 @@ extern double benchmark_connectblock_slow();
 extern double benchmark_sendtoaddress(CAmount amount);
 extern double benchmark_loadwallet();
 extern double benchmark_listunspent();
+extern double benchmark_availablecoins(size_t nUtxos);
+extern double benchmark_notarizeddata(int nPoints, bool fLinearScan);
 
 #endif